@@ -0,0 +1,53 @@
+/******************************************************************
+*
+* Adjacency.cpp
+*
+* Description: Construction of the point-to-spring index by counting
+* sort over the spring end points; runs in O(points + springs)
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include "Adjacency.h"
+
+void Adjacency::Build(const int numPoints, const vector<Spring>& springs)
+{
+	const auto n = numPoints;
+
+	/* Count springs per point, shifted by one for the prefix sum */
+	offsets.assign(n + 1, 0);
+
+	for (const auto& spring : springs)
+	{
+		offsets[spring.getPoint(0) + 1]++;
+		offsets[spring.getPoint(1) + 1]++;
+	}
+
+	for (int i = 0; i < n; i++)
+		offsets[i + 1] += offsets[i];
+
+	/* Scatter springs into their point buckets */
+	entries.resize(offsets[n]);
+
+	vector<int> fill(offsets.begin(), offsets.end() - 1);
+
+	for (int s = 0; s < (int)springs.size(); s++)
+	{
+		const auto i0 = springs[s].getPoint(0);
+		const auto i1 = springs[s].getPoint(1);
+
+		entries[fill[i0]++] = IncidentSpring{ s, i1 };
+		entries[fill[i1]++] = IncidentSpring{ s, i0 };
+	}
+}
+
+void Adjacency::Clear()
+{
+	offsets.clear();
+	entries.clear();
+}
@@ -0,0 +1,59 @@
+/******************************************************************
+*
+* Adjacency.h
+*
+* Description: Compressed (CSR-style) index from every mass point
+* to the springs attached to it; built once per scene topology so
+* that force evaluation only visits incident springs
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __ADJACENCY_H__
+#define __ADJACENCY_H__
+
+#include <vector>
+using namespace std;
+
+#include "Spring.h"
+
+/* One spring attached to a point, seen from that point */
+struct IncidentSpring
+{
+	int spring; /* Index into spring array */
+	int other;  /* Index of the opposite end point */
+};
+
+class Adjacency
+{
+private:
+	vector<int> offsets;            /* Per point start into entries, size n+1 */
+	vector<IncidentSpring> entries; /* Incident springs grouped by point */
+
+public:
+	void Build(int numPoints, const vector<Spring>& springs);
+	void Clear();
+
+	int GetNumPoints() const
+	{
+		return offsets.empty() ? 0 : (int)offsets.size() - 1;
+	}
+
+	/* Incident springs of point i as [begin, end) range */
+	const IncidentSpring* begin(int i) const
+	{
+		return entries.data() + offsets[i];
+	}
+
+	const IncidentSpring* end(int i) const
+	{
+		return entries.data() + offsets[i + 1];
+	}
+};
+
+#endif
@@ -0,0 +1,1282 @@
+/******************************************************************
+*
+* Bench.cpp
+*
+* Description: Headless benchmarks of the mass-spring solvers;
+* reports wall time per simulated second of the implicit Euler
+* integrator at increasing step sizes against symplectic Euler at
+* its reference step size, the cost of adaptive stepping against
+* the fixed-step methods, the throughput of the spring force
+* kernels supported by this CPU, of ensembles against single
+* scenes, or of the collision stage at up to a million points;
+* -bench checkpoint times taking and restoring checkpoints;
+* -bench scaling measures the strong scaling of the task pool;
+* -bench xpbd compares XPBD at up to frame-rate steps against
+* symplectic Euler; -bench precision runs every method in double
+* and in float and reports how far the float points drift from the
+* double ones
+*
+* -bench suite runs microbenchmarks of Vec2 arithmetic, the force
+* evaluations, every solver on generated scenes of increasing size
+* and the reference comparison; each is warmed up, repeated and
+* summarized in ns per unit of work (point-step for the solvers), as
+* ";"-separated table or JSON, with the threads pinned to cores so
+* results compare across commits
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+/* Standard includes */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+/* Local includes */
+#include "Scene.h"
+#include "Ensemble.h"
+#include "SpringKernel.h"
+#include "ContactGrid.h"
+#include "ContactSolver.h"
+#include "ReferenceSolution.h"
+#include "TaskPool.h"
+
+/* Force evaluations of Exercise.cpp, instantiated for double and float */
+template<class Real>
+BasicVec2<Real> compute_internal_forces(int i, const BasicParticleSystem<Real>& particles,
+                                        const vector<BasicSpring<Real>>& springs,
+                                        const Adjacency& adjacency);
+
+template<class Real>
+void accumulate_spring_forces(BasicParticleSystem<Real>& particles,
+                              const BasicSpringColoring<Real>& coloring);
+
+struct Settings
+{
+	Scene::Testcase testcase = Scene::HANGING;
+	double stiffness = 1000.0;
+	double damping = 0.5;
+	double mass = 0.15;
+	double step = 0.001;    /* Reference step of the explicit method */
+	double duration = 20.0; /* Simulated seconds per measurement */
+	double tolerance = 0.0; /* Adaptive error tolerance, 0 = sweep 1e-3 .. 1e-6 */
+	int substeps = 10;      /* Substeps per step of XPBD */
+	int iterations = 1;     /* Constraint sweeps per substep of XPBD */
+	int size = 32;          /* Points per side of generated scenes */
+	int springs = 1 << 20;  /* Random springs of the kernel benchmark */
+
+	/* Microbenchmark suite */
+	int repeats = 10;       /* Measured repetitions */
+	double warmup = 0.1;    /* Seconds run before measuring */
+	double minTime = 0.05;  /* Seconds per repetition at least */
+	bool json = false;      /* Output format, ";"-separated otherwise */
+	int threads = 0;        /* Threads, 0 = one per core */
+	bool pin = true;        /* Pin threads to cores */
+};
+
+/******************************************************************
+*
+* Measure
+*
+* Simulates the given duration and returns the wall time per
+* simulated second; the maximum RMS error is returned in error and
+* the accepted and rejected steps in steps
+*
+*******************************************************************/
+
+static double Measure(const Settings& settings, Scene::Method method,
+                      double step, double tolerance, ErrorStats& error, StepStats& steps)
+{
+	Scene scene(method, settings.testcase, step,
+	            settings.mass, settings.stiffness, settings.damping, settings.size);
+
+	scene.SetTolerance(tolerance);
+	scene.SetSubsteps(settings.substeps, settings.iterations);
+
+	const auto adaptive = Scene::IsAdaptive(method);
+	const auto count = (long)llround(settings.duration / step);
+
+	const auto start = chrono::steady_clock::now();
+
+	auto left = settings.duration;
+
+	for (long i = 0; (adaptive ? left > 0.0 : i < count) && isfinite(scene.GetError().last); i++)
+		left -= scene.Update(left);
+
+	const auto wall = chrono::duration<double>(
+		chrono::steady_clock::now() - start).count();
+
+	error = scene.GetError();
+	steps = scene.GetStepStats();
+
+	return wall / scene.GetTime();
+}
+
+static double Measure(const Settings& settings, Scene::Method method,
+                      double step, ErrorStats& error)
+{
+	StepStats steps;
+
+	return Measure(settings, method, step, 0.0, error, steps);
+}
+
+static void BenchImplicit(const Settings& settings)
+{
+	cout << "method;step;wall_per_sim_s;rms_max;speedup" << "\n";
+
+	ErrorStats error;
+
+	const auto reference = Measure(settings, Scene::SYMPLECTIC, settings.step, error);
+
+	cout << "symplectic;" << settings.step << ";" << reference << ";"
+	     << error.max << ";1" << "\n";
+
+	for (auto factor : { 1.0, 10.0, 30.0, 100.0 })
+	{
+		const auto step = settings.step * factor;
+		const auto wall = Measure(settings, Scene::IMPLICIT_EULER, step, error);
+
+		cout << "implicit;" << step << ";" << wall << ";"
+		     << error.max << ";" << reference / wall << "\n";
+	}
+}
+
+/******************************************************************
+*
+* BenchXpbd
+*
+* Wall time per simulated second of XPBD at steps up to the frame
+* time of 60 Hz against symplectic Euler at its reference step size;
+* rms_max is nan where a run diverged and 0 on generated scenes
+*
+*******************************************************************/
+
+static void BenchXpbd(const Settings& settings)
+{
+	cout << "method;step;substeps;wall_per_sim_s;rms_max;speedup" << "\n";
+
+	ErrorStats error;
+
+	const auto reference = Measure(settings, Scene::SYMPLECTIC, settings.step, error);
+
+	cout << "symplectic;" << settings.step << ";1;" << reference << ";"
+	     << error.max << ";1" << "\n";
+
+	for (auto step : { settings.step, 1.0 / 240.0, 1.0 / 120.0, 1.0 / 60.0 })
+	{
+		const auto wall = Measure(settings, Scene::XPBD, step, error);
+
+		cout << "xpbd;" << step << ";" << settings.substeps << ";" << wall << ";"
+		     << error.max << ";" << reference / wall << "\n";
+	}
+}
+
+/* Springs per second of every supported kernel for points of type
+   Real; the first call stores the forces of its scalar kernel as
+   reference for all deviations */
+template<class Real>
+static void TimeKernels(const ParticleSystem& source, const vector<Spring>& sourceSprings,
+                        const char* suffix, vector<double>& referenceX, vector<double>& referenceY)
+{
+	BasicParticleSystem<Real> particles;
+	particles.Assign(source);
+
+	vector<BasicSpring<Real>> springs;
+
+	for (const auto& spring : sourceSprings)
+		springs.emplace_back(spring);
+
+	const auto numPoints = particles.Size();
+	const auto numSprings = (int)springs.size();
+
+	BasicSpringColoring<Real> coloring;
+	coloring.Build(numPoints, springs);
+
+	for (auto type : { KERNEL_SCALAR, KERNEL_AVX2, KERNEL_AVX512 })
+	{
+		if (!IsSpringKernelSupported(type))
+			continue;
+
+		const auto kernel = GetSpringKernel<Real>(type);
+		const auto serial = GetSpringKernel<Real>(KERNEL_SCALAR);
+
+		auto passes = 0;
+		auto wall = 0.0;
+
+		const auto start = chrono::steady_clock::now();
+
+		/* Repeat whole passes over all colors for at least one second */
+		while (wall < 1.0)
+		{
+			fill(particles.fx.begin(), particles.fx.end(), (Real)0);
+			fill(particles.fy.begin(), particles.fy.end(), (Real)0);
+
+			for (int c = 0; c < coloring.GetNumColors(); c++)
+			{
+				/* Overflow springs may share end points */
+				const auto run = coloring.IsSerial(c) ? serial : kernel;
+				run(particles, coloring, coloring.First(c), coloring.Last(c));
+			}
+
+			passes++;
+			wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		}
+
+		if (referenceX.empty())
+		{
+			referenceX.assign(particles.fx.begin(), particles.fx.end());
+			referenceY.assign(particles.fy.begin(), particles.fy.end());
+		}
+
+		auto diff = 0.0;
+
+		for (int i = 0; i < numPoints; i++)
+		{
+			diff = max(diff, fabs(particles.fx[i] - referenceX[i]));
+			diff = max(diff, fabs(particles.fy[i] - referenceY[i]));
+		}
+
+		cout << GetSpringKernelName(type) << suffix << ";" << numSprings << ";"
+		     << coloring.GetNumColors() << ";"
+		     << (double)passes * numSprings / wall << ";" << diff << "\n";
+	}
+}
+
+/******************************************************************
+*
+* BenchKernels
+*
+* Builds random springs between settings.springs / 4 points and
+* reports springs per second of every supported force kernel, in
+* double and in float, with the largest force deviation from the
+* double scalar kernel
+*
+*******************************************************************/
+
+static void BenchKernels(const Settings& settings)
+{
+	const auto numSprings = settings.springs;
+	const auto numPoints = max(2, numSprings / 4);
+
+	default_random_engine rng;
+	uniform_real_distribution<double> position(-3.0, 3.0);
+	uniform_int_distribution<int> point(0, numPoints - 1);
+
+	ParticleSystem particles;
+	particles.Reserve(numPoints);
+
+	for (int i = 0; i < numPoints; i++)
+		particles.Add(Vec2(position(rng), position(rng)), settings.mass, settings.damping);
+
+	vector<Spring> springs(numSprings, Spring(settings.stiffness));
+
+	for (auto& spring : springs)
+	{
+		const auto p0 = point(rng);
+		auto p1 = point(rng);
+
+		if (p1 == p0)
+			p1 = (p0 + 1) % numPoints;
+
+		spring.init(p0, p1, particles);
+	}
+
+	/* Perturb the points so that the springs are not at rest */
+	for (int i = 0; i < numPoints; i++)
+		particles.SetPos(i, particles.GetPos(i) * 1.1);
+
+	cout << "kernel;springs;colors;springs_per_s;max_diff" << "\n";
+
+	vector<double> referenceX, referenceY;
+
+	TimeKernels<double>(particles, springs, "", referenceX, referenceY);
+	TimeKernels<float>(particles, springs, "_f32", referenceX, referenceY);
+}
+
+/******************************************************************
+*
+* BenchAdaptive
+*
+* Cost per simulated second and accuracy of the adaptive methods at
+* decreasing tolerances, next to the explicit fixed-step methods at
+* the reference step size
+*
+*******************************************************************/
+
+static void BenchAdaptive(const Settings& settings)
+{
+	cout << "method;tol;accepted;rejected;wall_per_sim_s;rms_max" << "\n";
+
+	ErrorStats error;
+	StepStats steps;
+
+	for (auto method : { Scene::SYMPLECTIC, Scene::MIDPOINT, Scene::VELOCITY_VERLET, Scene::RK4 })
+	{
+		const auto wall = Measure(settings, method, settings.step, 0.0, error, steps);
+
+		cout << Scene::GetMethodName(method) << ";-;" << steps.accepted << ";"
+		     << steps.rejected << ";" << wall << ";" << error.max << "\n";
+	}
+
+	auto tolerances = vector<double>{ 1e-3, 1e-4, 1e-5, 1e-6 };
+
+	if (settings.tolerance > 0.0)
+		tolerances = { settings.tolerance };
+
+	for (auto method : { Scene::ADAPTIVE, Scene::RK45 })
+	{
+		for (auto tolerance : tolerances)
+		{
+			const auto wall = Measure(settings, method, settings.step, tolerance, error, steps);
+
+			cout << Scene::GetMethodName(method) << ";" << tolerance << ";" << steps.accepted << ";"
+			     << steps.rejected << ";" << wall << ";" << error.max << "\n";
+		}
+	}
+}
+
+/******************************************************************
+*
+* BenchEnsemble
+*
+* Wall time of simulating instances configurations (stiffness spread
+* over 70 .. 160) of the test case one scene after another against
+* one ensemble of double and one of float state, with the explicit
+* method at the reference step
+*
+*******************************************************************/
+
+static void BenchEnsemble(const Settings& settings)
+{
+	cout << "method;instances;scenes_s;ensemble_s;speedup;ensemble_f32_s;speedup_f32" << "\n";
+
+	const auto count = (long)llround(settings.duration / settings.step);
+
+	for (auto method : { Scene::SYMPLECTIC, Scene::RK4 })
+	{
+		for (auto instances : { 1, 8, 64, 512 })
+		{
+			vector<EnsembleMember> members;
+
+			for (int k = 0; k < instances; k++)
+				members.push_back(EnsembleMember{ settings.mass, 70.0 + 90.0 * k / instances,
+				                                  settings.damping, settings.step });
+
+			auto start = chrono::steady_clock::now();
+
+			for (const auto& member : members)
+			{
+				Scene scene(method, settings.testcase, member.step,
+				            member.mass, member.stiffness, member.damping);
+
+				for (long i = 0; i < count; i++)
+					scene.Update();
+			}
+
+			const auto scenes = chrono::duration<double>(
+				chrono::steady_clock::now() - start).count();
+
+			start = chrono::steady_clock::now();
+
+			Ensemble ensemble(method, settings.testcase, Scene::INPLACE, members, false);
+			ensemble.Run(settings.duration);
+
+			const auto batched = chrono::duration<double>(
+				chrono::steady_clock::now() - start).count();
+
+			start = chrono::steady_clock::now();
+
+			EnsembleF32 single(method, settings.testcase, Scene::INPLACE, members, false);
+			single.Run(settings.duration);
+
+			const auto batchedSingle = chrono::duration<double>(
+				chrono::steady_clock::now() - start).count();
+
+			cout << Scene::GetMethodName(method) << ";" << instances << ";" << scenes << ";"
+			     << batched << ";" << scenes / batched << ";"
+			     << batchedSingle << ";" << scenes / batchedSingle << "\n";
+		}
+	}
+}
+
+/******************************************************************
+*
+* BenchContacts
+*
+* Time of the collision stage for one random point per unit square,
+* about two contacts per point; points are numbered row by row like
+* those of generated scenes. The pairs found by the grid are checked
+* against all pairs where that is affordable.
+*
+*******************************************************************/
+
+static void BenchContacts(const Settings& settings)
+{
+	cout << "points;contacts;build_ms;resolve_ms;ns_per_point;pairs;pairs_all" << "\n";
+
+	/* Unit spacing, contact distance 0.8 */
+	const auto radius = 0.4;
+
+	for (auto side : { 32, 100, 316, 1000 })
+	{
+		const auto n = side * side;
+
+		default_random_engine rng;
+		uniform_real_distribution<double> offset(0.0, 1.0);
+
+		ParticleSystem particles;
+		particles.Reserve(n);
+
+		for (int j = 0; j < side; j++)
+			for (int i = 0; i < side; i++)
+				particles.Add(Vec2(i + offset(rng), j + offset(rng)), settings.mass, settings.damping);
+
+		/* Best of repeated builds and solves, so buffers are allocated
+		   as during a simulation */
+		static constexpr int repeats = 5;
+
+		ContactGrid grid;
+		auto build = HUGE_VAL;
+
+		for (int r = 0; r < repeats; r++)
+		{
+			const auto start = chrono::steady_clock::now();
+			grid.Build(particles, 2.0 * radius);
+
+			build = min(build, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+		}
+
+		/* Pairs closer than the contact distance, each counted once */
+		const auto close = [&](const int i, const int j)
+		{
+			const auto dx = particles.x[i] - particles.x[j];
+			const auto dy = particles.y[i] - particles.y[j];
+
+			return dx * dx + dy * dy < 4.0 * radius * radius;
+		};
+
+		long pairs = 0;
+
+		for (int k = 0; k < n; k++)
+		{
+			grid.ForEachNeighbor(k, [&](const int m)
+			{
+				pairs += m > k && close(grid.GetPoint(k), grid.GetPoint(m));
+			});
+		}
+
+		long all = -1;
+
+		if (n <= 10000)
+		{
+			all = 0;
+
+			for (int i = 0; i < n; i++)
+				for (int j = i + 1; j < n; j++)
+					all += close(i, j);
+		}
+
+		ContactSolver solver;
+		solver.enabled = true;
+		solver.radius = radius;
+		solver.ground = 0.0;
+
+		auto resolve = HUGE_VAL;
+		auto contacts = 0;
+
+		for (int r = 0; r < repeats; r++)
+		{
+			auto touching = particles;
+
+			const auto start = chrono::steady_clock::now();
+			contacts = solver.Resolve(touching);
+
+			resolve = min(resolve, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+		}
+
+		cout << n << ";" << contacts << ";" << build * 1e3 << ";" << resolve * 1e3 << ";"
+		     << resolve * 1e9 / n << ";" << pairs << ";";
+
+		if (all >= 0)
+			cout << all << "\n";
+		else
+			cout << "-" << "\n";
+	}
+}
+
+/******************************************************************
+*
+* BenchCheckpoint
+*
+* Per method and precision, how long the simulation stalls to take
+* a checkpoint and how long a restore of the written file takes; a
+* scene restored from the checkpoint must continue exactly like the
+* one it was taken from
+*
+*******************************************************************/
+
+static void BenchCheckpoint(const Settings& settings)
+{
+	static const char* const path = "./bench.ckpt";
+	static constexpr int steps = 20; /* Before and after the checkpoint */
+
+	cout << "method;precision;points;springs;mbytes;capture_ms;restore_ms;identical" << "\n";
+
+	for (int m = Scene::EULER; m <= Scene::XPBD; m++)
+	{
+		const auto method = (Scene::Method)m;
+
+		for (auto precision : { Scene::DOUBLE, Scene::FLOAT })
+		{
+			Scene original(method, settings.testcase, settings.step,
+			               settings.mass, settings.stiffness, settings.damping, settings.size);
+
+			original.SetPrecision(precision);
+
+			for (int i = 0; i < steps; i++)
+				original.Update();
+
+			auto start = chrono::steady_clock::now();
+			original.SaveCheckpoint(path);
+
+			const auto capture = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			Scene restored(method, settings.testcase, settings.step,
+			               settings.mass, settings.stiffness, settings.damping, 2);
+
+			/* The write is not part of the restore */
+			original.FlushCheckpoints();
+
+			start = chrono::steady_clock::now();
+
+			if (!restored.RestoreCheckpoint(path))
+				exit(1);
+
+			const auto restore = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			for (int i = 0; i < steps; i++)
+			{
+				original.Update();
+				restored.Update();
+			}
+
+			const auto& a = original.GetParticles();
+			const auto& b = restored.GetParticles();
+
+			const auto identical = a.x == b.x && a.y == b.y && a.vx == b.vx && a.vy == b.vy &&
+			                       original.GetTime() == restored.GetTime() &&
+			                       original.GetError().sum == restored.GetError().sum;
+
+			const auto bytes = a.Size() * 10.0 * sizeof(double) + original.GetSprings().size() * sizeof(Spring);
+
+			cout << Scene::GetMethodName(method) << ";" << Scene::GetPrecisionName(precision) << ";"
+			     << a.Size() << ";" << original.GetSprings().size() << ";"
+			     << bytes / (1 << 20) << ";" << capture * 1e3 << ";" << restore * 1e3 << ";"
+			     << (identical ? "yes" : "no") << "\n";
+		}
+	}
+
+	remove(path);
+}
+
+/******************************************************************
+*
+* BenchPrecision
+*
+* Per method, the same scene stepped in double and in float (Scene
+* -precision): wall time per simulated second of both, the distance
+* of the float points from the double ones at the end as RMS and
+* maximum over all points, and on the analytical testcases the mean
+* RMS error of both against the analytical solution. A method
+* tolerates float on this scene if its float error stays within
+* tolerated_ratio of the double error; on generated scenes only the
+* deviation is reported.
+*
+*******************************************************************/
+
+static void BenchPrecision(const Settings& settings)
+{
+	static constexpr double tolerated_ratio = 1.1;
+
+	cout << "method;points;double_s;float_s;speedup;deviation_rms;deviation_max;"
+	     << "rms_mean;rms_mean_f32;verdict" << "\n";
+
+	const auto count = (long)llround(settings.duration / settings.step);
+
+	for (int m = Scene::EULER; m <= Scene::XPBD; m++)
+	{
+		const auto method = (Scene::Method)m;
+		const auto adaptive = Scene::IsAdaptive(method);
+
+		unique_ptr<Scene> scenes[2];
+		double wall[2];
+
+		for (int k = 0; k < 2; k++)
+		{
+			scenes[k].reset(new Scene(method, settings.testcase, settings.step,
+			                          settings.mass, settings.stiffness, settings.damping, settings.size));
+
+			auto& scene = *scenes[k];
+
+			if (settings.tolerance > 0.0)
+				scene.SetTolerance(settings.tolerance);
+
+			scene.SetSubsteps(settings.substeps, settings.iterations);
+			scene.SetPrecision(k ? Scene::FLOAT : Scene::DOUBLE);
+
+			const auto start = chrono::steady_clock::now();
+
+			auto left = settings.duration;
+
+			for (long i = 0; (adaptive ? left > 0.0 : i < count) && isfinite(scene.GetError().last); i++)
+				left -= scene.Update(left);
+
+			wall[k] = chrono::duration<double>(
+				chrono::steady_clock::now() - start).count() / scene.GetTime();
+		}
+
+		const auto& a = scenes[0]->GetParticles();
+		const auto& b = scenes[1]->GetParticles();
+
+		auto sum = 0.0;
+		auto largest = 0.0;
+
+		for (int i = 0; i < a.Size(); i++)
+		{
+			const auto d = hypot(a.x[i] - b.x[i], a.y[i] - b.y[i]);
+
+			sum += d * d;
+
+			/* Also takes over NaN of a diverged run */
+			if (!(d <= largest))
+				largest = d;
+		}
+
+		const auto analytical = settings.testcase < Scene::CLOTH;
+		const auto error = scenes[0]->GetError().Mean();
+		const auto errorSingle = scenes[1]->GetError().Mean();
+
+		cout << Scene::GetMethodName(method) << ";" << a.Size() << ";"
+		     << wall[0] << ";" << wall[1] << ";" << wall[0] / wall[1] << ";"
+		     << sqrt(sum / a.Size()) << ";" << largest << ";";
+
+		if (!analytical)
+			cout << "-;-;-" << "\n";
+		else
+			cout << error << ";" << errorSingle << ";"
+			     << (errorSingle <= tolerated_ratio * error ? "tolerates float" : "needs double") << "\n";
+	}
+}
+
+/* Summary of the repetitions of one microbenchmark, ns per unit */
+struct SuiteResult
+{
+	string bench;
+	string variant;   /* Method, operation or kernel */
+	int size;         /* Points per side, vector length */
+	long units;       /* Units of work per call of the body */
+	string unit;
+	int diverged;     /* Repetitions that ended with non-finite state */
+	double min, median, mean, stddev;
+};
+
+/******************************************************************
+*
+* PinThreads
+*
+* Sets the number of threads of the task pool and, on Linux, binds
+* thread t to the t-th core the process may run on; the pool binds
+* its workers, the calling thread is thread 0 of every loop. Returns
+* the number of threads.
+*
+*******************************************************************/
+
+static int PinThreads(const Settings& settings)
+{
+	SetWorkerThreads(settings.threads, settings.pin);
+
+#ifdef __linux__
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+
+	for (int c = 0; c < CPU_SETSIZE && settings.pin; c++)
+	{
+		if (CPU_ISSET(c, &allowed))
+		{
+			cpu_set_t core;
+			CPU_ZERO(&core);
+			CPU_SET(c, &core);
+			pthread_setaffinity_np(pthread_self(), sizeof(core), &core);
+			break;
+		}
+	}
+#endif
+
+	return GetWorkerThreads();
+}
+
+/******************************************************************
+*
+* Microbench
+*
+* Calls setup() untimed before the warmup and every repetition, then
+* body() until the repetition took settings.minTime; body returns
+* false once the state is no longer finite, which ends and counts
+* the repetition. Reports min, median, mean and standard deviation
+* of the repetitions in ns per unit, units per call of body.
+*
+*******************************************************************/
+
+template<class S, class B>
+static SuiteResult Microbench(const Settings& settings, const char* bench, const string& variant,
+                              const int size, const long units, const char* unit,
+                              const S& setup, const B& body)
+{
+	using clock = chrono::steady_clock;
+
+	const auto run = [&](const double seconds, bool& finite)
+	{
+		long calls = 0;
+		finite = true;
+
+		const auto start = clock::now();
+		auto wall = 0.0;
+
+		/* Check the clock every few calls only */
+		for (long batch = 1; wall < seconds && finite; batch = min(batch * 2, 1024L))
+		{
+			for (long i = 0; i < batch && finite; i++, calls++)
+				finite = body();
+
+			wall = chrono::duration<double>(clock::now() - start).count();
+		}
+
+		return wall * 1e9 / ((double)calls * units);
+	};
+
+	SuiteResult result = { bench, variant, size, units, unit, 0, 0.0, 0.0, 0.0, 0.0 };
+
+	bool finite;
+
+	setup();
+	run(settings.warmup, finite);
+
+	vector<double> times;
+
+	for (int r = 0; r < settings.repeats; r++)
+	{
+		setup();
+		times.push_back(run(settings.minTime, finite));
+
+		if (!finite)
+			result.diverged++;
+	}
+
+	sort(times.begin(), times.end());
+
+	const auto n = (int)times.size();
+
+	result.min = times[0];
+	result.median = n % 2 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+
+	for (auto t : times)
+		result.mean += t / n;
+
+	for (auto t : times)
+		result.stddev += (t - result.mean) * (t - result.mean) / max(1, n - 1);
+
+	result.stddev = sqrt(result.stddev);
+
+	return result;
+}
+
+/* Results of the suite as table or JSON */
+static void PrintSuite(const Settings& settings, const int threads, const vector<SuiteResult>& results)
+{
+	if (settings.json)
+	{
+		cout << "{" << "\n";
+		cout << "  \"threads\": " << threads << ", \"pinned\": " << (settings.pin ? "true" : "false")
+		     << ", \"repeats\": " << settings.repeats << ", \"kernel\": \""
+		     << GetSpringKernelName(GetBestSpringKernel()) << "\"," << "\n";
+		cout << "  \"results\": [" << "\n";
+
+		for (size_t k = 0; k < results.size(); k++)
+		{
+			const auto& r = results[k];
+
+			cout << "    { \"bench\": \"" << r.bench << "\", \"variant\": \"" << r.variant
+			     << "\", \"size\": " << r.size << ", \"units\": " << r.units
+			     << ", \"unit\": \"" << r.unit << "\", \"diverged\": " << r.diverged
+			     << ", \"min_ns\": " << r.min << ", \"median_ns\": " << r.median
+			     << ", \"mean_ns\": " << r.mean << ", \"stddev_ns\": " << r.stddev << " }"
+			     << (k + 1 < results.size() ? "," : "") << "\n";
+		}
+
+		cout << "  ]" << "\n" << "}" << "\n";
+		return;
+	}
+
+	cout << "bench;variant;size;units;unit;threads;repeats;diverged;min_ns;median_ns;mean_ns;stddev_ns" << "\n";
+
+	for (const auto& r : results)
+	{
+		cout << r.bench << ";" << r.variant << ";" << r.size << ";" << r.units << ";" << r.unit << ";"
+		     << threads << ";" << settings.repeats << ";" << r.diverged << ";"
+		     << r.min << ";" << r.median << ";" << r.mean << ";" << r.stddev << "\n";
+	}
+}
+
+/******************************************************************
+*
+* BenchSuite
+*
+* Vec2 operations on 4096 vectors; compute_internal_forces of every
+* point and the force kernels on generated cloths; one step of
+* every solver on cloths of 8 .. settings.size points per side; the
+* reference solution and RMS error on hanging chains of those sizes
+*
+*******************************************************************/
+
+static void BenchSuite(const Settings& settings)
+{
+	const auto threads = PinThreads(settings);
+
+	vector<SuiteResult> results;
+
+	vector<int> sizes;
+
+	for (int side = 8; side <= settings.size; side *= 2)
+		sizes.push_back(side);
+
+	/* Keeps results of the bodies alive */
+	volatile double sink = 0.0;
+
+	/* Vec2 arithmetic */
+	{
+		static constexpr int count = 4096;
+
+		default_random_engine rng;
+		uniform_real_distribution<double> value(-1.0, 1.0);
+
+		vector<Vec2> a(count), b(count), c(count);
+
+		for (int i = 0; i < count; i++)
+		{
+			a[i] = Vec2(value(rng), value(rng));
+			b[i] = Vec2(value(rng), value(rng));
+		}
+
+		const auto none = []() {};
+
+		results.push_back(Microbench(settings, "vec2", "axpy", count, count, "vector", none, [&]()
+		{
+			for (int i = 0; i < count; i++)
+				c[i] = a[i] + 0.5 * (b[i] - a[i]);
+
+			sink = c[count - 1].x;
+			return true;
+		}));
+
+		results.push_back(Microbench(settings, "vec2", "dot", count, count, "vector", none, [&]()
+		{
+			auto sum = 0.0;
+
+			for (int i = 0; i < count; i++)
+				sum += a[i].dot(b[i]);
+
+			sink = sum;
+			return true;
+		}));
+
+		results.push_back(Microbench(settings, "vec2", "normalize", count, count, "vector", none, [&]()
+		{
+			for (int i = 0; i < count; i++)
+				c[i] = (b[i] - a[i]).normalize();
+
+			sink = c[count - 1].x;
+			return true;
+		}));
+	}
+
+	/* Force evaluation of all points of a cloth */
+	for (auto side : sizes)
+	{
+		const Scene scene(Scene::SYMPLECTIC, Scene::CLOTH, settings.step,
+		                  settings.mass, settings.stiffness, settings.damping, side);
+
+		auto particles = scene.GetParticles();
+		const auto& springs = scene.GetSprings();
+		const auto& adjacency = scene.GetAdjacency();
+		const auto n = particles.Size();
+
+		/* Springs away from rest length */
+		for (int i = 0; i < n; i++)
+			particles.SetPos(i, particles.GetPos(i) * 1.1);
+
+		SpringColoring coloring;
+		coloring.Build(n, springs);
+
+		const auto none = []() {};
+
+		results.push_back(Microbench(settings, "forces", "compute_internal_forces", side, n, "point", none, [&]()
+		{
+			auto sum = 0.0;
+
+			for (int i = 0; i < n; i++)
+				sum += compute_internal_forces(i, particles, springs, adjacency).x;
+
+			sink = sum;
+			return true;
+		}));
+
+		results.push_back(Microbench(settings, "forces", "accumulate_spring_forces", side, n, "point", none, [&]()
+		{
+			accumulate_spring_forces(particles, coloring);
+
+			sink = particles.fx[n - 1];
+			return true;
+		}));
+	}
+
+	/* One time step of every solver; every repetition starts at rest */
+	for (auto method : { Scene::EULER, Scene::SYMPLECTIC, Scene::LEAPFROG, Scene::MIDPOINT,
+	                     Scene::IMPLICIT_EULER, Scene::VELOCITY_VERLET, Scene::ADAPTIVE,
+	                     Scene::RK2, Scene::RK4, Scene::RK45, Scene::XPBD })
+	{
+		for (auto side : sizes)
+		{
+			unique_ptr<Scene> scene;
+
+			const auto setup = [&]()
+			{
+				scene.reset(new Scene(method, Scene::CLOTH, settings.step,
+				                      settings.mass, settings.stiffness, settings.damping, side));
+			};
+
+			setup();
+
+			const auto n = scene->GetParticles().Size();
+
+			results.push_back(Microbench(settings, "step", Scene::GetMethodName(method), side, n,
+			                             "point-step", setup, [&]()
+			{
+				scene->Update();
+
+				return (bool)isfinite(scene->GetParticles().y[n - 1]);
+			}));
+		}
+	}
+
+	/* Reference solution and error of a hanging scene */
+	for (auto side : sizes)
+	{
+		const Scene scene(Scene::SYMPLECTIC, Scene::CHAINS, settings.step,
+		                  settings.mass, settings.stiffness, settings.damping, side);
+
+		const auto& particles = scene.GetParticles();
+		const auto n = particles.Size();
+
+		ReferenceSolution solution;
+		ParticleSystem reference;
+		auto time = 0.0;
+
+		const auto setup = [&]()
+		{
+			solution.Init(particles, scene.GetSprings(), scene.GetAdjacency());
+			reference = particles;
+			time = 0.0;
+		};
+
+		results.push_back(Microbench(settings, "reference", "evaluate_compare", side, n, "point-step",
+		                             setup, [&]()
+		{
+			time += settings.step;
+			solution.Evaluate(time, settings.step, 1, reference);
+
+			auto sum = 0.0;
+
+			for (int i = 0; i < n; i++)
+			{
+				const auto dx = reference.x[i] - particles.x[i];
+				const auto dy = reference.y[i] - particles.y[i];
+
+				sum += dx * dx + dy * dy;
+			}
+
+			sink = sqrt(sum / n);
+			return true;
+		}));
+	}
+
+	PrintSuite(settings, threads, results);
+}
+
+/******************************************************************
+*
+* BenchScaling
+*
+* Strong scaling of the task pool: steps of the methods whose phases
+* run on it, and of symplectic Euler with the collision stage, on a
+* cloth of settings.size points per side, with 1, 2, 4 .. threads up
+* to one per core (or settings.threads); ns per point-step, speedup
+* and efficiency against one thread, and whether the points after a
+* fixed number of steps equal those of one thread
+*
+*******************************************************************/
+
+static void BenchScaling(const Settings& settings)
+{
+	/* Steps compared between thread counts */
+	static constexpr int steps = 20;
+
+	const auto cores = settings.threads > 0 ? settings.threads : max(1, (int)thread::hardware_concurrency());
+
+	vector<int> counts;
+
+	for (int t = 1; t < cores; t *= 2)
+		counts.push_back(t);
+
+	counts.push_back(cores);
+
+	const auto points = settings.size * settings.size;
+
+	if (points <= parallel_points)
+		cerr << "Cloth of " << points << " points is stepped on one thread, use -size 65 or more" << endl;
+
+	cout << "method;points;threads;min_ns;median_ns;speedup;efficiency;identical" << "\n";
+
+	struct Run
+	{
+		Scene::Method method;
+		bool contacts;
+	};
+
+	for (auto run : { Run{ Scene::EULER, false }, Run{ Scene::SYMPLECTIC, false },
+	                  Run{ Scene::IMPLICIT_EULER, false }, Run{ Scene::VELOCITY_VERLET, false },
+	                  Run{ Scene::RK4, false }, Run{ Scene::RK45, false }, Run{ Scene::XPBD, false },
+	                  Run{ Scene::SYMPLECTIC, true } })
+	{
+		const auto name = string(Scene::GetMethodName(run.method)) + (run.contacts ? "+contacts" : "");
+
+		const auto create = [&]()
+		{
+			unique_ptr<Scene> scene(new Scene(run.method, Scene::CLOTH, settings.step,
+			                                  settings.mass, settings.stiffness, settings.damping, settings.size));
+			scene->SetStepping(Scene::TWOPHASE);
+
+			if (run.contacts)
+				scene->ToggleContacts();
+
+			return scene;
+		};
+
+		vector<double> x, y;
+		auto single = 0.0;
+
+		for (auto threads : counts)
+		{
+			SetWorkerThreads(threads, settings.pin);
+
+			auto scene = create();
+			const auto n = scene->GetParticles().Size();
+
+			const auto result = Microbench(settings, "scaling", name, settings.size,
+			                               n, "point-step", []() {}, [&]()
+			{
+				scene->Update();
+
+				return (bool)isfinite(scene->GetParticles().y[n - 1]);
+			});
+
+			scene = create();
+
+			for (int i = 0; i < steps; i++)
+				scene->Update();
+
+			const auto& particles = scene->GetParticles();
+
+			if (threads == 1)
+			{
+				single = result.median;
+				x = particles.x;
+				y = particles.y;
+			}
+
+			const auto speedup = single / result.median;
+
+			cout << name << ";" << n << ";" << threads << ";" << result.min << ";"
+			     << result.median << ";" << speedup << ";" << speedup / threads << ";"
+			     << (particles.x == x && particles.y == y ? "yes" : "no") << "\n";
+		}
+	}
+}
+
+static void PrintUsage()
+{
+	cerr << "Usage: ./MassSpringBench -[option1] [setting1] -[option2] [setting2] ..." << endl;
+	cerr << "Options:" << endl;
+	cerr << "\t-bench [implicit, adaptive, kernel, ensemble, contacts, checkpoint, scaling," << endl;
+	cerr << "\t        xpbd, precision, suite]" << endl;
+	cerr << "\t-testcase [spring1D, hanging, falling, cloth, lattice, chains]" << endl;
+	cerr << "\t-size [points per side of generated scenes]" << endl;
+	cerr << "\t-step [reference step size]" << endl;
+	cerr << "\t-stiff [stiffness]" << endl;
+	cerr << "\t-damp [damping]" << endl;
+	cerr << "\t-mass [mass]" << endl;
+	cerr << "\t-duration [simulated seconds]" << endl;
+	cerr << "\t-tol [error tolerance of adaptive, default sweep]" << endl;
+	cerr << "\t-substeps [substeps per step of xpbd]" << endl;
+	cerr << "\t-iterations [constraint sweeps per substep of xpbd]" << endl;
+	cerr << "\t-springs [number of springs, kernel benchmark]" << endl;
+	cerr << "\t-repeat [measured repetitions, suite, scaling]" << endl;
+	cerr << "\t-warmup [seconds before measuring, suite, scaling]" << endl;
+	cerr << "\t-mintime [seconds per repetition, suite, scaling]" << endl;
+	cerr << "\t-format [csv, json]" << endl;
+	cerr << "\t-threads [threads, 0 = one per core; largest count of scaling]" << endl;
+	cerr << "\t-pin [on, off] (threads to cores, suite, scaling)" << endl << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	Settings settings;
+	auto bench = string("implicit");
+
+	for (int arg = 1; arg < argc; arg += 2)
+	{
+		if (arg + 1 >= argc)
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		const auto value = argv[arg + 1];
+
+		if (!strcmp(argv[arg], "-bench"))
+		{
+			bench = value;
+
+			if (bench != "implicit" && bench != "adaptive" && bench != "kernel" &&
+			    bench != "ensemble" && bench != "contacts" && bench != "checkpoint" &&
+			    bench != "scaling" && bench != "xpbd" && bench != "precision" &&
+			    bench != "suite")
+			{
+				cerr << "Unrecognized benchmark: " << value << endl;
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[arg], "-testcase"))
+		{
+			if (!Scene::ParseTestcase(value, settings.testcase))
+			{
+				cerr << "Unrecognized testcase: " << value << endl;
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[arg], "-step"))
+			settings.step = atof(value);
+		else if (!strcmp(argv[arg], "-stiff"))
+			settings.stiffness = atof(value);
+		else if (!strcmp(argv[arg], "-damp"))
+			settings.damping = atof(value);
+		else if (!strcmp(argv[arg], "-mass"))
+			settings.mass = atof(value);
+		else if (!strcmp(argv[arg], "-duration"))
+			settings.duration = atof(value);
+		else if (!strcmp(argv[arg], "-tol"))
+			settings.tolerance = atof(value);
+		else if (!strcmp(argv[arg], "-substeps"))
+			settings.substeps = max(1, atoi(value));
+		else if (!strcmp(argv[arg], "-iterations"))
+			settings.iterations = max(1, atoi(value));
+		else if (!strcmp(argv[arg], "-size"))
+			settings.size = max(2, atoi(value));
+		else if (!strcmp(argv[arg], "-springs"))
+			settings.springs = atoi(value);
+		else if (!strcmp(argv[arg], "-repeat"))
+			settings.repeats = max(1, atoi(value));
+		else if (!strcmp(argv[arg], "-warmup"))
+			settings.warmup = atof(value);
+		else if (!strcmp(argv[arg], "-mintime"))
+			settings.minTime = atof(value);
+		else if (!strcmp(argv[arg], "-threads"))
+			settings.threads = atoi(value);
+		else if (!strcmp(argv[arg], "-format"))
+		{
+			if (strcmp(value, "csv") && strcmp(value, "json"))
+			{
+				cerr << "Unrecognized format: " << value << endl;
+				return 1;
+			}
+
+			settings.json = !strcmp(value, "json");
+		}
+		else if (!strcmp(argv[arg], "-pin"))
+		{
+			if (strcmp(value, "on") && strcmp(value, "off"))
+			{
+				cerr << "Unrecognized pin setting: " << value << endl;
+				return 1;
+			}
+
+			settings.pin = !strcmp(value, "on");
+		}
+		else
+		{
+			cerr << endl << "Unrecognized option: " << argv[arg] << endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (bench == "kernel")
+		BenchKernels(settings);
+	else if (bench == "adaptive")
+		BenchAdaptive(settings);
+	else if (bench == "contacts")
+		BenchContacts(settings);
+	else if (bench == "checkpoint")
+		BenchCheckpoint(settings);
+	else if (bench == "scaling")
+		BenchScaling(settings);
+	else if (bench == "xpbd")
+		BenchXpbd(settings);
+	else if (bench == "precision")
+		BenchPrecision(settings);
+	else if (bench == "suite")
+		BenchSuite(settings);
+	else if (bench == "ensemble")
+	{
+		if (settings.testcase >= Scene::CLOTH)
+		{
+			cerr << "Ensembles need an analytical testcase" << endl;
+			return 1;
+		}
+
+		BenchEnsemble(settings);
+	}
+	else
+		BenchImplicit(settings);
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/******************************************************************
+*
+* ButcherTableau.h
+*
+* Description: Coefficients of explicit Runge-Kutta methods as
+* constexpr data; the integrators in Exercise.cpp take a tableau as
+* template argument, so every method compiles into its own loops
+* without looking up coefficients at run time
+*
+* Spring and user forces do not depend on time, so the nodes c are
+* not needed. Embedded methods carry the weights e = b - b^ of the
+* error estimate and are first same as last: the last stage is
+* evaluated at the new state (a[S - 1] = b).
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __BUTCHER_TABLEAU_H__
+#define __BUTCHER_TABLEAU_H__
+
+#include <type_traits>
+#include <utility>
+using namespace std;
+
+template<int S>
+struct ButcherTableau
+{
+	static constexpr int stages = S;
+
+	double a[S][S];   /* Stage weights, strictly lower triangular */
+	double b[S];      /* Weights of the new state */
+	double e[S];      /* Weights of the error estimate, zero if not embedded */
+	int errorOrder;   /* Order of the error estimate + 1, step control exponent */
+};
+
+/* Calls f(integral_constant<int, s>()) for s = 0 .. S - 1 in order, so
+   every stage is compiled with its own constant coefficients */
+template<class F, int... S>
+void for_each_stage(integer_sequence<int, S...>, const F& f)
+{
+	(f(integral_constant<int, S>()), ...);
+}
+
+/* Heun's method, second order */
+constexpr ButcherTableau<2> rk2_tableau =
+{
+	{
+		{ 0.0, 0.0 },
+		{ 1.0, 0.0 },
+	},
+	{ 1.0 / 2.0, 1.0 / 2.0 },
+	{ 0.0, 0.0 },
+	0
+};
+
+/* Classical fourth order Runge-Kutta */
+constexpr ButcherTableau<4> rk4_tableau =
+{
+	{
+		{ 0.0, 0.0, 0.0, 0.0 },
+		{ 1.0 / 2.0, 0.0, 0.0, 0.0 },
+		{ 0.0, 1.0 / 2.0, 0.0, 0.0 },
+		{ 0.0, 0.0, 1.0, 0.0 },
+	},
+	{ 1.0 / 6.0, 1.0 / 3.0, 1.0 / 3.0, 1.0 / 6.0 },
+	{ 0.0, 0.0, 0.0, 0.0 },
+	0
+};
+
+/* Bogacki-Shampine 3(2) */
+constexpr ButcherTableau<4> bs23_tableau =
+{
+	{
+		{ 0.0, 0.0, 0.0, 0.0 },
+		{ 1.0 / 2.0, 0.0, 0.0, 0.0 },
+		{ 0.0, 3.0 / 4.0, 0.0, 0.0 },
+		{ 2.0 / 9.0, 1.0 / 3.0, 4.0 / 9.0, 0.0 },
+	},
+	{ 2.0 / 9.0, 1.0 / 3.0, 4.0 / 9.0, 0.0 },
+	{ 2.0 / 9.0 - 7.0 / 24.0, 1.0 / 3.0 - 1.0 / 4.0, 4.0 / 9.0 - 1.0 / 3.0, -1.0 / 8.0 },
+	3
+};
+
+/* Dormand-Prince 5(4) */
+constexpr ButcherTableau<7> dopri5_tableau =
+{
+	{
+		{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+		{ 1.0 / 5.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+		{ 3.0 / 40.0, 9.0 / 40.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+		{ 44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0, 0.0, 0.0, 0.0, 0.0 },
+		{ 19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0, 0.0, 0.0, 0.0 },
+		{ 9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0, 0.0, 0.0 },
+		{ 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0, 0.0 },
+	},
+	{ 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0, 0.0 },
+	{
+		35.0 / 384.0 - 5179.0 / 57600.0,
+		0.0,
+		500.0 / 1113.0 - 7571.0 / 16695.0,
+		125.0 / 192.0 - 393.0 / 640.0,
+		-2187.0 / 6784.0 + 92097.0 / 339200.0,
+		11.0 / 84.0 - 187.0 / 2100.0,
+		-1.0 / 40.0
+	},
+	5
+};
+
+#endif
@@ -0,0 +1,380 @@
+/******************************************************************
+*
+* Checkpoint.cpp
+*
+* Description: Reading and writing of checkpoints and the writer
+* thread, see Checkpoint.h
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+#include "Checkpoint.h"
+#include "MappedFile.h"
+
+static const char checkpoint_magic[8] = { 'M', 'S', 'C', 'K', 'P', 'T', 0, 0 };
+static constexpr uint32_t checkpoint_version = 4;
+static constexpr uint32_t checkpoint_byte_order = 0x01020304;
+
+static_assert(is_trivially_copyable<Spring>::value, "Springs are stored as they are in memory");
+static_assert(is_trivially_copyable<CheckpointScalars>::value, "Scalars are stored as they are in memory");
+
+/* Point arrays of equal length, in file order */
+static constexpr int point_arrays = 10;
+
+static vector<double> ParticleSystem::* const point_members[point_arrays] =
+{
+	&ParticleSystem::x, &ParticleSystem::y, &ParticleSystem::vx, &ParticleSystem::vy,
+	&ParticleSystem::fx, &ParticleSystem::fy, &ParticleSystem::ux, &ParticleSystem::uy,
+	&ParticleSystem::invMass, &ParticleSystem::damping
+};
+
+/* Byte offsets of the blocks within a file */
+struct CheckpointLayout
+{
+	size_t scalars, rng, path;
+	size_t points[point_arrays];
+	size_t fixed, springs, rx, ry, terms;
+	size_t end;
+};
+
+static size_t Align(const size_t offset)
+{
+	return (offset + 63) & ~size_t(63);
+}
+
+static CheckpointLayout GetLayout(const CheckpointFileHeader& header)
+{
+	const auto points = header.numPoints * sizeof(double);
+	const auto reference = (header.flags & CheckpointReference) ? points : 0;
+
+	CheckpointLayout layout;
+
+	layout.scalars = sizeof(CheckpointFileHeader);
+	layout.rng = Align(layout.scalars + sizeof(CheckpointScalars));
+	layout.path = Align(layout.rng + header.rngBytes);
+	layout.points[0] = Align(layout.path + header.pathBytes);
+
+	for (int a = 1; a < point_arrays; a++)
+		layout.points[a] = Align(layout.points[a - 1] + points);
+
+	layout.fixed = Align(layout.points[point_arrays - 1] + points);
+	layout.springs = Align(layout.fixed + (header.numPoints + 63) / 64 * sizeof(uint64_t));
+	layout.rx = Align(layout.springs + header.numSprings * sizeof(Spring));
+	layout.ry = Align(layout.rx + reference);
+	layout.terms = Align(layout.ry + reference);
+	layout.end = layout.terms + header.numTerms * sizeof(double);
+
+	return layout;
+}
+
+template<class T>
+static const T* ArrayAt(const MappedFile& file, const size_t offset)
+{
+	return reinterpret_cast<const T*>(file.Data() + offset);
+}
+
+bool LoadCheckpoint(const char* path, Checkpoint& checkpoint)
+{
+	MappedFile file;
+
+	if (!file.Open(path))
+	{
+		cerr << "Cannot open checkpoint: " << path << endl;
+		return false;
+	}
+
+	CheckpointFileHeader header;
+
+	if (file.Size() < sizeof(header))
+	{
+		cerr << "Checkpoint too short: " << path << endl;
+		return false;
+	}
+
+	memcpy(&header, file.Data(), sizeof(header));
+
+	if (memcmp(header.magic, checkpoint_magic, sizeof(checkpoint_magic)) ||
+	    header.version != checkpoint_version)
+	{
+		cerr << "Not a version " << checkpoint_version << " checkpoint: " << path << endl;
+		return false;
+	}
+
+	if (header.byteOrder != checkpoint_byte_order || header.scalarBytes != sizeof(CheckpointScalars))
+	{
+		cerr << "Checkpoint written by a different kind of machine: " << path << endl;
+		return false;
+	}
+
+	/* Indices are int in memory */
+	if (header.numPoints > 0x7fffffff || header.numSprings > 0x7fffffff ||
+	    header.numTerms > 0x7fffffff)
+	{
+		cerr << "Checkpoint too large: " << path << endl;
+		return false;
+	}
+
+	const auto n = (int)header.numPoints;
+	const auto m = (int)header.numSprings;
+	const auto layout = GetLayout(header);
+
+	if (file.Size() < layout.end)
+	{
+		cerr << "Checkpoint truncated: " << path << endl;
+		return false;
+	}
+
+	const auto springs = ArrayAt<Spring>(file, layout.springs);
+
+	for (int s = 0; s < m; s++)
+	{
+		if (springs[s].getPoint(0) >= n || springs[s].getPoint(1) >= n)
+		{
+			cerr << "Spring " << s << " references missing point: " << path << endl;
+			return false;
+		}
+	}
+
+	memcpy(&checkpoint.scalars, file.Data() + layout.scalars, sizeof(CheckpointScalars));
+
+	checkpoint.rng.assign(ArrayAt<char>(file, layout.rng), header.rngBytes);
+	checkpoint.sceneFile.assign(ArrayAt<char>(file, layout.path), header.pathBytes);
+
+	/* Arrays are copied as a whole straight out of the mapping */
+	auto& particles = checkpoint.particles;
+
+	for (int a = 0; a < point_arrays; a++)
+	{
+		const auto values = ArrayAt<double>(file, layout.points[a]);
+		(particles.*point_members[a]).assign(values, values + n);
+	}
+
+	const auto fixed = ArrayAt<uint64_t>(file, layout.fixed);
+	particles.fixedMask.assign(fixed, fixed + (n + 63) / 64);
+
+	checkpoint.springs.assign(springs, springs + m);
+
+	if (header.flags & CheckpointReference)
+	{
+		const auto rx = ArrayAt<double>(file, layout.rx);
+		const auto ry = ArrayAt<double>(file, layout.ry);
+
+		checkpoint.rx.assign(rx, rx + n);
+		checkpoint.ry.assign(ry, ry + n);
+	}
+	else
+	{
+		checkpoint.rx.clear();
+		checkpoint.ry.clear();
+	}
+
+	const auto terms = ArrayAt<double>(file, layout.terms);
+	checkpoint.terms.assign(terms, terms + header.numTerms);
+
+	/* Without reference points there is nothing to compare with */
+	checkpoint.scalars.hasReference = (header.flags & CheckpointReference) != 0;
+
+	return true;
+}
+
+/* Writes an array at offset followed by zero padding up to end,
+   which becomes the new offset */
+static void WriteArray(ofstream& os, const void* data, const size_t bytes,
+                       size_t& offset, const size_t end)
+{
+	static const char zeros[64] = {};
+
+	os.write(static_cast<const char*>(data), bytes);
+	os.write(zeros, end - offset - bytes);
+
+	offset = end;
+}
+
+bool WriteCheckpoint(const char* path, const Checkpoint& checkpoint)
+{
+	const auto& particles = checkpoint.particles;
+	const auto n = particles.Size();
+	const auto m = checkpoint.springs.size();
+	const auto reference = checkpoint.scalars.hasReference && (int)checkpoint.rx.size() == n;
+
+	CheckpointFileHeader header = {};
+	memcpy(header.magic, checkpoint_magic, sizeof(checkpoint_magic));
+	header.version = checkpoint_version;
+	header.byteOrder = checkpoint_byte_order;
+	header.numPoints = n;
+	header.numSprings = m;
+	header.rngBytes = (uint32_t)checkpoint.rng.size();
+	header.pathBytes = (uint32_t)checkpoint.sceneFile.size();
+	header.flags = reference ? CheckpointReference : 0;
+	header.scalarBytes = sizeof(CheckpointScalars);
+	header.numTerms = checkpoint.terms.size();
+
+	const auto layout = GetLayout(header);
+	const auto temporary = string(path) + ".tmp";
+
+	ofstream os(temporary, ios::binary | ios::trunc);
+
+	if (!os)
+	{
+		cerr << "Cannot write checkpoint: " << temporary << endl;
+		return false;
+	}
+
+	const auto points = n * sizeof(double);
+
+	size_t offset = 0;
+
+	WriteArray(os, &header, sizeof(header), offset, layout.scalars);
+	WriteArray(os, &checkpoint.scalars, sizeof(CheckpointScalars), offset, layout.rng);
+	WriteArray(os, checkpoint.rng.data(), header.rngBytes, offset, layout.path);
+	WriteArray(os, checkpoint.sceneFile.data(), header.pathBytes, offset, layout.points[0]);
+
+	for (int a = 0; a < point_arrays; a++)
+	{
+		const auto end = a + 1 < point_arrays ? layout.points[a + 1] : layout.fixed;
+		WriteArray(os, (particles.*point_members[a]).data(), points, offset, end);
+	}
+
+	WriteArray(os, particles.fixedMask.data(), particles.fixedMask.size() * sizeof(uint64_t), offset, layout.springs);
+	WriteArray(os, checkpoint.springs.data(), m * sizeof(Spring), offset, layout.rx);
+
+	if (reference)
+	{
+		WriteArray(os, checkpoint.rx.data(), points, offset, layout.ry);
+		WriteArray(os, checkpoint.ry.data(), points, offset, layout.terms);
+	}
+
+	WriteArray(os, checkpoint.terms.data(), header.numTerms * sizeof(double), offset, layout.end);
+
+	os.close();
+
+	if (!os)
+	{
+		cerr << "Error writing checkpoint: " << temporary << endl;
+		remove(temporary.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	/* rename does not replace existing files on Windows */
+	remove(path);
+#endif
+
+	if (rename(temporary.c_str(), path))
+	{
+		cerr << "Cannot replace checkpoint: " << path << endl;
+		return false;
+	}
+
+	return true;
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+	Close();
+}
+
+Checkpoint& CheckpointWriter::Begin()
+{
+	lock_guard<mutex> guard(lock);
+
+	if (!writer.joinable())
+	{
+		running = true;
+		writer = thread(&CheckpointWriter::Write, this);
+	}
+
+	/* Never the buffer being written; an unwritten one is replaced */
+	if (pending >= 0)
+	{
+		filling = pending;
+		pending = -1;
+		replaced++;
+	}
+	else
+		filling = writing == 0 ? 1 : 0;
+
+	return buffers[filling];
+}
+
+void CheckpointWriter::Commit(const char* path)
+{
+	{
+		lock_guard<mutex> guard(lock);
+
+		paths[filling] = path;
+		pending = filling;
+		filling = -1;
+	}
+
+	wake.notify_all();
+}
+
+void CheckpointWriter::Flush()
+{
+	unique_lock<mutex> guard(lock);
+
+	wake.wait(guard, [this]() { return pending < 0 && writing < 0; });
+}
+
+Checkpoint& CheckpointWriter::Spare()
+{
+	Flush();
+
+	/* Only the simulation takes buffers, so none is in use now */
+	return buffers[0];
+}
+
+void CheckpointWriter::Close()
+{
+	if (!writer.joinable())
+		return;
+
+	{
+		lock_guard<mutex> guard(lock);
+		running = false;
+	}
+
+	wake.notify_all();
+	writer.join();
+
+	if (replaced > 0)
+		cerr << "Checkpoint writer replaced " << replaced << " unwritten checkpoints" << endl;
+}
+
+void CheckpointWriter::Write()
+{
+	unique_lock<mutex> guard(lock);
+
+	for (;;)
+	{
+		wake.wait(guard, [this]() { return pending >= 0 || !running; });
+
+		if (pending < 0)
+			break;
+
+		writing = pending;
+		pending = -1;
+
+		const auto path = paths[writing];
+
+		/* The simulation only fills the other buffer meanwhile */
+		guard.unlock();
+		WriteCheckpoint(path.c_str(), buffers[writing]);
+		guard.lock();
+
+		writing = -1;
+		wake.notify_all();
+	}
+}
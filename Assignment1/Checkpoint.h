@@ -0,0 +1,165 @@
+/******************************************************************
+*
+* Checkpoint.h
+*
+* Description: Versioned binary checkpoints (*.ckpt) of the complete
+* state of a running scene, so a simulation continues exactly where
+* it stopped - after a restart or after trying other parameters
+*
+* A 64 byte header is followed by the scalars and flat arrays, each
+* starting on a 64 byte boundary:
+*
+*   scalars                 CheckpointScalars
+*   rng                     char[rngBytes], engine state as text
+*   sceneFile               char[pathBytes], binary scene, if any
+*   x, y, vx, vy, fx, fy,
+*   ux, uy, invMass,
+*   damping                 double[points], also for scenes stepped
+*                           in float (exact, see Scene::Narrow)
+*   fixed                   uint64[(points + 63) / 64], bit per point
+*   springs                 Spring[springs], see Spring.h
+*   rx, ry                  double[points], analytical reference
+*                           (CheckpointReference only)
+*   terms                   double[terms], constants of the reference
+*                           after parameter changes, see
+*                           ReferenceSolution::GetTerms
+*
+* Like scene files, checkpoints are stored in host byte order and
+* loaded with one bulk copy per array out of a mapping of the file.
+* The stages of the multi-stage methods are not stored; the first
+* step after a restore evaluates them again.
+*
+* Checkpoints are written by a background thread from one of two
+* buffers: the simulation copies its state into the free buffer and
+* continues while the other one is written. A checkpoint that was
+* not yet started when the next one is taken is replaced by it.
+* Restores load into an idle buffer and swap its arrays with those
+* of the scene, so neither allocates once both buffers are in use.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "ParticleSystem.h"
+#include "Spring.h"
+#include "SimulationState.h"
+
+struct CheckpointFileHeader
+{
+	char magic[8];          /* "MSCKPT" */
+	uint32_t version;
+	uint32_t byteOrder;     /* 0x01020304 as written by the host */
+	uint64_t numPoints;
+	uint64_t numSprings;
+	uint32_t rngBytes;
+	uint32_t pathBytes;
+	uint32_t flags;         /* CheckpointReference */
+	uint32_t scalarBytes;   /* sizeof(CheckpointScalars) of the writer */
+	uint64_t numTerms;
+	uint64_t reserved;
+};
+
+static_assert(sizeof(CheckpointFileHeader) == 64, "Checkpoint header must be 64 bytes");
+
+static constexpr uint32_t CheckpointReference = 1;
+
+/* Parameters of the scene and bookkeeping of its simulation */
+struct CheckpointScalars
+{
+	int32_t method, stepping, testcase;
+	int32_t size, sample;
+	int32_t interaction, contacts, analytical, hasReference;
+	int32_t substeps, iterations;
+	int32_t precision;      /* Scalar type the solver steps in */
+
+	double step, tolerance, mass, stiffness, damping;
+	double ground, radius;
+	double initialMass, initialStiffness, initialDamping, initialStep;
+
+	double time;
+	double referenceOrigin; /* Time of the last parameter change */
+	ErrorStats error;
+	StepStats steps;
+	StepControl control;
+	ErrorSampling sampling;
+};
+
+struct Checkpoint
+{
+	CheckpointScalars scalars;
+	string rng;             /* Engine state as written by operator<< */
+	string sceneFile;       /* Binary scene the points came from, if any */
+
+	ParticleSystem particles;
+	vector<Spring> springs;
+	vector<double> rx, ry;  /* Reference points, if scalars.hasReference */
+	vector<double> terms;   /* Reference constants, empty if not analytical */
+};
+
+/* Replace the contents of checkpoint by the file; prints the reason
+   to cerr and returns false, if the file cannot be used */
+bool LoadCheckpoint(const char* path, Checkpoint& checkpoint);
+
+/* Write to path.tmp and rename to path when complete, so a failed
+   write keeps the previous checkpoint */
+bool WriteCheckpoint(const char* path, const Checkpoint& checkpoint);
+
+class CheckpointWriter
+{
+private:
+	Checkpoint buffers[2];
+	string paths[2];
+
+	int filling = -1;          /* Buffer taken by Begin */
+	int pending = -1;          /* Buffer committed, but not yet written */
+	int writing = -1;          /* Buffer the writer thread writes */
+	bool running = false;
+	long replaced = 0;         /* Checkpoints replaced before written */
+
+	thread writer;
+	mutex lock;
+	condition_variable wake;
+
+	void Write();              /* Writer thread */
+
+public:
+	CheckpointWriter() {}
+	~CheckpointWriter();
+
+	CheckpointWriter(const CheckpointWriter&) = delete;
+	CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+	/* Buffer to fill with the next checkpoint; never waits for the
+	   disk, storage of earlier checkpoints is reused */
+	Checkpoint& Begin();
+
+	/* Queue the buffer returned by Begin for writing to path */
+	void Commit(const char* path);
+
+	/* Wait until all committed checkpoints are written */
+	void Flush();
+
+	/* Flush and return a buffer to load a checkpoint into; loads and
+	   captures then reuse the same storage */
+	Checkpoint& Spare();
+
+	/* Write the committed checkpoints and stop the writer thread */
+	void Close();
+};
+
+#endif
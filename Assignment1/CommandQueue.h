@@ -0,0 +1,66 @@
+/******************************************************************
+*
+* CommandQueue.h
+*
+* Description: Bounded lock-free queue from one producer thread to
+* one consumer thread; Push fails instead of waiting when the queue
+* is full, Pop fails when it is empty
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __COMMAND_QUEUE_H__
+#define __COMMAND_QUEUE_H__
+
+#include <atomic>
+using namespace std;
+
+template<class T, unsigned N>
+class CommandQueue
+{
+private:
+	static_assert(N > 0 && (N & (N - 1)) == 0, "Capacity must be a power of two");
+
+	T items[N];
+
+	/* Running counts of pushed and popped items, on separate cache
+	   lines so producer and consumer do not share one */
+	alignas(64) atomic<unsigned> tail{ 0 };
+	alignas(64) atomic<unsigned> head{ 0 };
+
+public:
+	/* Producer */
+	bool Push(const T& item)
+	{
+		const auto t = tail.load(memory_order_relaxed);
+
+		if (t - head.load(memory_order_acquire) == N)
+			return false;
+
+		items[t & (N - 1)] = item;
+		tail.store(t + 1, memory_order_release);
+
+		return true;
+	}
+
+	/* Consumer */
+	bool Pop(T& item)
+	{
+		const auto h = head.load(memory_order_relaxed);
+
+		if (h == tail.load(memory_order_acquire))
+			return false;
+
+		item = items[h & (N - 1)];
+		head.store(h + 1, memory_order_release);
+
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,164 @@
+/******************************************************************
+*
+* ContactGrid.cpp
+*
+* Description: Counting sort of the points into the hashed cells of
+* the grid on the task pool; runs in O(points) per build
+*
+* Counts and scatter positions are claimed atomically, so points end
+* up in their bucket in any order; sorting every bucket afterwards
+* makes the neighbor order, and with it the contact response, the
+* same for any number of threads.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ContactGrid.h"
+#include "TaskPool.h"
+
+/* Atomic increment of a counter shared between threads; returns the
+   previous value */
+static int fetch_increment(int& value)
+{
+#ifdef _MSC_VER
+	return _InterlockedExchangeAdd(reinterpret_cast<volatile long*>(&value), 1);
+#else
+	return __atomic_fetch_add(&value, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/* Blocks of the threaded prefix sum */
+static constexpr auto scan_blocks = 64;
+
+/* Cell coordinates are clamped, so far away and diverged points
+   still map to a valid cell */
+static int cell_of(const double coordinate, const double inverse)
+{
+	static constexpr double limit = 1 << 30;
+
+	const auto c = floor(coordinate * inverse);
+
+	return (int)(c >= -limit ? (c <= limit ? c : limit) : -limit);
+}
+
+/* Inclusive prefix sum of values[1 .. n] in blocks, values[0] = 0 */
+static void prefix_sum(vector<int>& values, const int n)
+{
+	const auto size = (n + scan_blocks - 1) / scan_blocks;
+
+	int sums[scan_blocks + 1] = {};
+
+	/* f(b) for every block, one block per range of the task pool */
+	const auto blocks = [&](const auto& f)
+	{
+		const auto scan = [&](const int begin, const int end)
+		{
+			for (int b = begin; b < end; b++)
+				f(b);
+		};
+
+		if (n > parallel_points)
+			ParallelFor(0, scan_blocks, 1, scan);
+		else
+			scan(0, scan_blocks);
+	};
+
+	blocks([&](const int b)
+	{
+		const auto first = 1 + b * size;
+		const auto last = min(n + 1, first + size);
+
+		for (auto i = first + 1; i < last; i++)
+			values[i] += values[i - 1];
+
+		sums[b + 1] = first < last ? values[last - 1] : 0;
+	});
+
+	for (int b = 0; b < scan_blocks; b++)
+		sums[b + 1] += sums[b];
+
+	blocks([&](const int b)
+	{
+		const auto first = 1 + b * size;
+		const auto last = min(n + 1, first + size);
+
+		for (auto i = first; i < last; i++)
+			values[i] += sums[b];
+	});
+}
+
+template<class Real>
+void ContactGrid::Build(const BasicParticleSystem<Real>& particles, const double cellSize)
+{
+	const auto n = particles.Size();
+
+	/* At least twice as many buckets as points keeps them short */
+	auto buckets = 1;
+
+	while (buckets < 2 * n)
+		buckets *= 2;
+
+	inverse = 1.0 / cellSize;
+	mask = (uint32_t)buckets - 1;
+
+	cellX.resize(n);
+	cellY.resize(n);
+	bucket.resize(n);
+	order.resize(n);
+	offsets.resize(buckets + 1);
+	fill.resize(buckets);
+
+	ParallelForEach(buckets + 1, [&](const int b)
+	{
+		offsets[b] = 0;
+	});
+
+	/* Count points per bucket, shifted by one for the prefix sum */
+	ParallelForEach(n, [&](const int i)
+	{
+		bucket[i] = Hash(cell_of(particles.x[i], inverse), cell_of(particles.y[i], inverse)) & mask;
+
+		fetch_increment(offsets[bucket[i] + 1]);
+	});
+
+	prefix_sum(offsets, buckets);
+
+	ParallelForEach(buckets, [&](const int b)
+	{
+		fill[b] = offsets[b];
+	});
+
+	/* Scatter points into their buckets */
+	ParallelForEach(n, [&](const int i)
+	{
+		order[fetch_increment(fill[bucket[i]])] = i;
+	});
+
+	ParallelForEach(buckets, [&](const int b)
+	{
+		if (offsets[b + 1] - offsets[b] > 1)
+			sort(order.begin() + offsets[b], order.begin() + offsets[b + 1]);
+	});
+
+	/* Cells in slot order for the lookup */
+	ParallelForEach(n, [&](const int k)
+	{
+		cellX[k] = cell_of(particles.x[order[k]], inverse);
+		cellY[k] = cell_of(particles.y[order[k]], inverse);
+	});
+}
+
+template void ContactGrid::Build(const ParticleSystem&, double);
+template void ContactGrid::Build(const ParticleSystemF32&, double);
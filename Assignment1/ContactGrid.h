@@ -0,0 +1,106 @@
+/******************************************************************
+*
+* ContactGrid.h
+*
+* Description: Uniform grid broadphase for point contacts; points are
+* binned into square cells of the contact distance, and a point can
+* only touch points of its own and the eight surrounding cells
+*
+* Cells are hashed into a power-of-two table of buckets, so the grid
+* needs no bounds and its memory is linear in the number of points.
+* Build() sorts the points into buckets by a counting sort; the sorted
+* positions are the slots of the grid. Points that share a bucket but
+* not the cell are filtered by the lookup.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __CONTACT_GRID_H__
+#define __CONTACT_GRID_H__
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+#include "ParticleSystem.h"
+
+class ContactGrid
+{
+private:
+	double inverse = 1.0;       /* Cells per unit length */
+	uint32_t mask = 0;          /* Buckets - 1 */
+
+	vector<int> cellX, cellY;   /* Cell per slot */
+	vector<uint32_t> bucket;    /* Bucket per point */
+	vector<int> offsets;        /* Per bucket start into the slots, size buckets + 1 */
+	vector<int> order;          /* Point per slot, grouped by bucket, ascending within */
+	vector<int> fill;           /* Scatter position per bucket */
+
+	/* Cells of a row go to consecutive buckets, rows are spread over
+	   the table by an odd stride */
+	static uint32_t Hash(const int x, const int y)
+	{
+		return (uint32_t)x + (uint32_t)y * 0x9e3779b1u;
+	}
+
+public:
+	/* Bin all points into cells of the given size */
+	template<class Real>
+	void Build(const BasicParticleSystem<Real>& particles, double cellSize);
+
+	int Size() const
+	{
+		return (int)order.size();
+	}
+
+	/* Point in slot k; neighboring cells are close in slot order */
+	int GetPoint(const int k) const
+	{
+		return order[k];
+	}
+
+	/* Calls f(m) for every slot m != k in the cells around slot k; the
+	   order of m is the same in every run */
+	template<class F>
+	void ForEachNeighbor(const int k, const F& f) const
+	{
+		const auto first = cellX[k] - 1;
+
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			const auto cy = cellY[k] + dy;
+			const auto b = Hash(first, cy) & mask;
+
+			/* The three cells of the row are one range of slots,
+			   unless the buckets wrap around the end of the table */
+			if (b + 2 <= mask)
+			{
+				for (auto m = offsets[b]; m < offsets[b + 3]; m++)
+				{
+					if (m != k && cellY[m] == cy && (unsigned)(cellX[m] - first) <= 2u)
+						f(m);
+				}
+
+				continue;
+			}
+
+			for (int dx = 0; dx <= 2; dx++)
+			{
+				const auto c = (b + dx) & mask;
+
+				for (auto m = offsets[c]; m < offsets[c + 1]; m++)
+				{
+					if (m != k && cellY[m] == cy && cellX[m] == first + dx)
+						f(m);
+				}
+			}
+		}
+	}
+};
+
+#endif
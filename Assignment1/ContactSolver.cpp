@@ -0,0 +1,186 @@
+/******************************************************************
+*
+* ContactSolver.cpp
+*
+* Description: Projection of point-point and point-ground contacts,
+* see ContactSolver.h; the grid is built once per step with the
+* contact distance as cell size
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <utility>
+
+#include "ContactSolver.h"
+#include "TaskPool.h"
+
+/* Coincident points have no contact normal and are left alone */
+static constexpr double tiny_distance = 0.00000001;
+
+void ContactSolver::SlotState::Resize(const int n)
+{
+	x.resize(n);
+	y.resize(n);
+	vx.resize(n);
+	vy.resize(n);
+}
+
+template<class Real>
+int ContactSolver::Resolve(BasicParticleSystem<Real>& particles)
+{
+	const auto n = particles.Size();
+	const auto distance = 2.0 * radius;
+	const auto lowest = ground + radius;
+
+	grid.Build(particles, distance);
+
+	before.Resize(n);
+	after.Resize(n);
+	weight.resize(n);
+	moved.resize(n);
+
+	/* Gather the points once; sweeps then stream through slot order */
+	ParallelRanges(n, [&](const int begin, const int end)
+	{
+		for (int k = begin; k < end; k++)
+		{
+			const auto i = grid.GetPoint(k);
+
+			before.x[k] = particles.x[i];
+			before.y[k] = particles.y[i];
+			before.vx[k] = particles.vx[i];
+			before.vy[k] = particles.vy[i];
+			weight[k] = particles.IsFixed(i) ? 0.0 : particles.invMass[i];
+			moved[k] = 0;
+		}
+	});
+
+	auto found = 0;
+
+	for (int sweep = 0; sweep < iterations; sweep++)
+	{
+		const auto& p = before;
+		auto& q = after;
+
+		/* Integer counts, exact in any order */
+		atomic<int> contacts{0};
+
+		ParallelRanges(n, [&](const int begin, const int end)
+		{
+			auto local = 0;
+
+			for (int k = begin; k < end; k++)
+			{
+				auto x = p.x[k], y = p.y[k];
+				auto vx = p.vx[k], vy = p.vy[k];
+
+				const auto wk = weight[k];
+
+				auto cx = 0.0, cy = 0.0;
+				auto cvx = 0.0, cvy = 0.0;
+				auto count = 0;
+
+				if (wk != 0.0)
+				{
+					grid.ForEachNeighbor(k, [&](const int m)
+					{
+						const auto dx = x - p.x[m];
+						const auto dy = y - p.y[m];
+						const auto d2 = dx * dx + dy * dy;
+
+						if (d2 >= distance * distance || d2 < tiny_distance * tiny_distance)
+							return;
+
+						const auto d = sqrt(d2);
+						const auto nx = dx * (1.0 / d);
+						const auto ny = dy * (1.0 / d);
+
+						/* Fixed points take no share of the correction */
+						const auto share = wk / (wk + weight[m]);
+
+						cx += share * (distance - d) * nx;
+						cy += share * (distance - d) * ny;
+
+						const auto vn = (vx - p.vx[m]) * nx + (vy - p.vy[m]) * ny;
+
+						if (vn < 0.0)
+						{
+							cvx -= share * vn * nx;
+							cvy -= share * vn * ny;
+						}
+
+						count++;
+					});
+
+					if (count > 0)
+					{
+						const auto mean = 1.0 / count;
+
+						x += cx * mean;
+						y += cy * mean;
+						vx += cvx * mean;
+						vy += cvy * mean;
+					}
+
+					if (y < lowest)
+					{
+						y = lowest;
+						vy = max(vy, 0.0);
+						count++;
+					}
+				}
+
+				q.x[k] = x;
+				q.y[k] = y;
+				q.vx[k] = vx;
+				q.vy[k] = vy;
+
+				if (count > 0)
+					moved[k] = 1;
+
+				local += count;
+			}
+
+			contacts += local;
+		});
+
+		swap(before, after);
+
+		if (sweep == 0)
+			found = contacts;
+
+		/* Nothing touches; later sweeps would not move anything */
+		if (contacts == 0)
+			break;
+	}
+
+	/* Write back the points that moved */
+	ParallelRanges(n, [&](const int begin, const int end)
+	{
+		for (int k = begin; k < end; k++)
+		{
+			if (!moved[k])
+				continue;
+
+			const auto i = grid.GetPoint(k);
+
+			particles.x[i] = (Real)before.x[k];
+			particles.y[i] = (Real)before.y[k];
+			particles.vx[i] = (Real)before.vx[k];
+			particles.vy[i] = (Real)before.vy[k];
+		}
+	});
+
+	return found;
+}
+
+template int ContactSolver::Resolve(ParticleSystem&);
+template int ContactSolver::Resolve(ParticleSystemF32&);
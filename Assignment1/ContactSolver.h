@@ -0,0 +1,64 @@
+/******************************************************************
+*
+* ContactSolver.h
+*
+* Description: Collision stage run after every time step; points are
+* discs of one radius that must not overlap each other and must stay
+* above the ground line y = ground
+*
+* Contacts are resolved by projection: every sweep moves each point
+* by the mean of its corrections against the state of the previous
+* sweep (Jacobi), split between two points by inverse mass, and
+* removes the approaching normal velocity (inelastic, frictionless).
+* Every point only writes to itself, so sweeps run in parallel.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __CONTACT_SOLVER_H__
+#define __CONTACT_SOLVER_H__
+
+#include <vector>
+using namespace std;
+
+#include "ParticleSystem.h"
+#include "ContactGrid.h"
+
+class ContactSolver
+{
+public:
+	bool enabled = false;
+	double radius = 0.1;     /* Contact radius of every point */
+	double ground = -2.5;    /* Height of the ground line */
+	int iterations = 4;      /* Projection sweeps per step */
+
+	/* Separate touching points; returns the contacts found by the
+	   first sweep, point-point contacts count for both points; the
+	   sweeps run in double for either point type */
+	template<class Real>
+	int Resolve(BasicParticleSystem<Real>& particles);
+
+private:
+	ContactGrid grid;
+
+	/* Positions and velocities in slot order */
+	struct SlotState
+	{
+		vector<double> x, y, vx, vy;
+
+		void Resize(int n);
+	};
+
+	/* State before and after a sweep, swapped after every sweep */
+	SlotState before, after;
+
+	vector<double> weight;   /* Inverse mass per slot, zero if fixed */
+	vector<char> moved;      /* Slot touched anything in any sweep */
+};
+
+#endif
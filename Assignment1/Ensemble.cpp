@@ -0,0 +1,743 @@
+/******************************************************************
+*
+* Ensemble.cpp
+*
+* Description: Lockstep integration of all instances of an ensemble;
+* the update formulas are those of Exercise.cpp, written as loops
+* over the instances of one point or spring. Finished and diverged
+* instances step with h = 0, which leaves their state unchanged and
+* keeps the loops free of branches.
+*
+* Iterations of an instance loop touch only their own instance, so
+* the loops are marked as simd; the compiler could not prove that
+* the many arrays involved do not overlap.
+*
+* Constants and literals in the state loops are converted to Real,
+* so a float ensemble computes in float throughout; for double the
+* conversions are no-ops and the results those of Exercise.cpp.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <algorithm>
+#include <cmath>
+
+#include "Ensemble.h"
+#include "ButcherTableau.h"
+#include "ReferenceSolution.h"
+
+/* Gravity and the shortest spring with a direction, as in Exercise.cpp */
+static constexpr double g = -10.0;
+static constexpr double tiny_distance = 0.00000001;
+
+template<class Real>
+BasicEnsemble<Real>::BasicEnsemble(const Scene::Method _method, const Scene::Testcase testcase,
+                                   const Scene::Stepping _stepping, const vector<EnsembleMember>& members,
+                                   const bool _recordSeries)
+{
+	method = _method;
+	stepping = _stepping;
+	recordSeries = _recordSeries;
+	interval = 1;
+
+	numInstances = (int)members.size();
+
+	/* Initial state and topology of the test case; parameters of
+	   the instances are applied below */
+	const auto& first = members.front();
+	const Scene scene(method, testcase, first.step, first.mass, first.stiffness, first.damping);
+
+	const auto& particles = scene.GetParticles();
+	const auto& springs = scene.GetSprings();
+
+	numPoints = particles.Size();
+	adjacency = scene.GetAdjacency();
+
+	for (const auto& spring : springs)
+	{
+		i0.push_back(spring.getPoint(0));
+		i1.push_back(spring.getPoint(1));
+		restLength.push_back((Real)spring.getRestLength());
+		referenceLength.push_back(spring.getRestLength());
+	}
+
+	for (int p = 0; p < numPoints; p++)
+		fixed.push_back(particles.IsFixed(p) ? 1 : 0);
+
+	const auto n = numInstances;
+
+	for (const auto& member : members)
+	{
+		/* Points keep the reciprocal mass (ParticleSystem::GetMass) */
+		const auto m = 1.0 / (1.0 / member.mass);
+
+		invMass.push_back((Real)(1.0 / member.mass));
+		mass.push_back((Real)m);
+		stiffness.push_back((Real)member.stiffness);
+		damping.push_back((Real)member.damping);
+		step.push_back(member.step);
+
+		/* Constants of the analytical solution in double, as in
+		   ReferenceSolution::Init */
+		const auto w = sqrt(member.stiffness / m);
+
+		wr.push_back(member.damping / (2 * m));
+		wbar.push_back(sqrt(w * w - wr.back() * wr.back()));
+		ratio.push_back(wr.back() / wbar.back());
+		scale.push_back(m * g / member.stiffness);
+	}
+
+	shape.resize(n);
+
+	time.assign(n, 0.0);
+	steps.assign(n, 0);
+	taken.assign(n, 0);
+	sampled.assign(n, 0);
+	diverged.assign(n, 0);
+	error.assign(n, ErrorStats());
+	series.assign(n, vector<double>());
+
+	const auto size = (size_t)numPoints * n;
+
+	x.resize(size);
+	y.resize(size);
+	vx.resize(size);
+	vy.resize(size);
+	fx.resize(size);
+	fy.resize(size);
+
+	rx.resize(size);
+	ry.resize(size);
+
+	for (int p = 0; p < numPoints; p++)
+	{
+		for (int k = 0; k < n; k++)
+		{
+			x[p * n + k] = (Real)particles.x[p];
+			y[p * n + k] = (Real)particles.y[p];
+			vx[p * n + k] = (Real)particles.vx[p];
+			vy[p * n + k] = (Real)particles.vy[p];
+			rx[p * n + k] = particles.x[p];
+			ry[p * n + k] = particles.y[p];
+		}
+	}
+
+	/* y0 and the stages of the Runge-Kutta methods, y0 of midpoint */
+	auto slots = 0;
+
+	if (method == Scene::RK2)
+		slots = rk2_tableau.stages + 1;
+	else if (method == Scene::RK4)
+		slots = rk4_tableau.stages + 1;
+	else if (method == Scene::MIDPOINT)
+		slots = 1;
+
+	stage.resize((size_t)slots * 4 * size);
+}
+
+template<class Real>
+bool BasicEnsemble<Real>::IsSupported(const Scene::Method m)
+{
+	switch (m)
+	{
+		case Scene::EULER:
+		case Scene::SYMPLECTIC:
+		case Scene::LEAPFROG:
+		case Scene::MIDPOINT:
+		case Scene::VELOCITY_VERLET:
+		case Scene::RK2:
+		case Scene::RK4:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/* Gravity plus spring-centric forces of all points from one state
+   (accumulate_spring_forces) */
+template<class Real>
+void BasicEnsemble<Real>::SpringForces()
+{
+	const auto n = numInstances;
+	const auto gravity = (Real)g;
+	const auto tiny = (Real)tiny_distance;
+	const auto X = x.data();
+	const auto Y = y.data();
+	const auto FX = fx.data();
+	const auto FY = fy.data();
+
+	for (int p = 0; p < numPoints; p++)
+	{
+		#pragma omp simd
+		for (int k = 0; k < n; k++)
+		{
+			FX[p * n + k] = 0;
+			FY[p * n + k] = mass[k] * gravity;
+		}
+	}
+
+	for (size_t j = 0; j < restLength.size(); j++)
+	{
+		const auto a = (size_t)i0[j] * n;
+		const auto b = (size_t)i1[j] * n;
+		const auto L = restLength[j];
+
+		#pragma omp simd
+		for (int k = 0; k < n; k++)
+		{
+			const auto dx = X[a + k] - X[b + k];
+			const auto dy = Y[a + k] - Y[b + k];
+
+			const auto distance = sqrt(dx * dx + dy * dy);
+
+			const auto force = stiffness[k] * (L - distance) / distance;
+			const auto scale = distance < tiny ? (Real)0 : force;
+
+			FX[a + k] += scale * dx;
+			FY[a + k] += scale * dy;
+			FX[b + k] -= scale * dx;
+			FY[b + k] -= scale * dy;
+		}
+	}
+}
+
+/* Gravity plus spring forces of point p from the current positions,
+   including already updated neighbors (compute_internal_forces) */
+template<class Real>
+void BasicEnsemble<Real>::PointForces(const int p)
+{
+	const auto n = numInstances;
+	const auto gravity = (Real)g;
+	const auto tiny = (Real)tiny_distance;
+	const auto o = (size_t)p * n;
+	const auto X = x.data();
+	const auto Y = y.data();
+	const auto FX = fx.data();
+	const auto FY = fy.data();
+
+	#pragma omp simd
+	for (int k = 0; k < n; k++)
+	{
+		FX[o + k] = 0;
+		FY[o + k] = 0;
+	}
+
+	for (auto it = adjacency.begin(p); it != adjacency.end(p); ++it)
+	{
+		const auto q = (size_t)it->other * n;
+		const auto L = restLength[it->spring];
+
+		#pragma omp simd
+		for (int k = 0; k < n; k++)
+		{
+			const auto cx = X[o + k] - X[q + k];
+			const auto cy = Y[o + k] - Y[q + k];
+
+			const auto distance = sqrt(cx * cx + cy * cy);
+
+			const auto scale = stiffness[k] * (L - distance);
+			const auto forceX = scale * (cx / distance);
+			const auto forceY = scale * (cy / distance);
+			const auto skip = distance < tiny;
+
+			FX[o + k] += skip ? (Real)0 : forceX;
+			FY[o + k] += skip ? (Real)0 : forceY;
+		}
+	}
+
+	#pragma omp simd
+	for (int k = 0; k < n; k++)
+		FY[o + k] += mass[k] * gravity;
+}
+
+/******************************************************************
+*
+* RungeKutta
+*
+* runge_kutta of Exercise.cpp for all instances; stage s stores k_s
+* and moves every point to the input of the next stage
+*
+*******************************************************************/
+
+template<class Real>
+template<const auto& T>
+void BasicEnsemble<Real>::RungeKutta(const Real* h)
+{
+	constexpr auto S = remove_reference_t<decltype(T)>::stages;
+
+	const auto n = numInstances;
+
+	for_each_stage(make_integer_sequence<int, S>(), [&](const auto stageIndex)
+	{
+		constexpr auto s = decltype(stageIndex)::value;
+
+		SpringForces();
+
+		Real* const state[4] = { x.data(), y.data(), vx.data(), vy.data() };
+
+		for (int p = 0; p < numPoints; p++)
+		{
+			if (fixed[p])
+				continue;
+
+			const auto o = (size_t)p * n;
+
+			if (s == 0)
+			{
+				for (int c = 0; c < 4; c++)
+					copy(state[c] + o, state[c] + o + n, Stage(0, c) + o);
+			}
+
+			const auto kx = Stage(s + 1, 0) + o;
+			const auto ky = Stage(s + 1, 1) + o;
+			const auto kvx = Stage(s + 1, 2) + o;
+			const auto kvy = Stage(s + 1, 3) + o;
+
+			#pragma omp simd
+			for (int k = 0; k < n; k++)
+			{
+				kx[k] = vx[o + k];
+				ky[k] = vy[o + k];
+				kvx[k] = (fx[o + k] - damping[k] * vx[o + k]) * invMass[k];
+				kvy[k] = (fy[o + k] - damping[k] * vy[o + k]) * invMass[k];
+			}
+
+			for (int c = 0; c < 4; c++)
+			{
+				const auto y0 = Stage(0, c) + o;
+				const auto out = state[c] + o;
+
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					Real sum = 0;
+
+					/* Weights of the next stage, or of the new state */
+					for_each_stage(make_integer_sequence<int, s + 1>(), [&](const auto weightIndex)
+					{
+						constexpr auto j = decltype(weightIndex)::value;
+						constexpr auto w = s + 1 < S ? T.a[s + 1][j] : T.b[j];
+
+						if constexpr (w != 0.0)
+							sum += (Real)w * Stage(j + 1, c)[o + k];
+					});
+
+					out[k] = y0[k] + h[k] * sum;
+				}
+			}
+		}
+	});
+}
+
+/******************************************************************
+*
+* Integrate
+*
+* One step of h[k] for every instance k
+*
+*******************************************************************/
+
+template<class Real>
+void BasicEnsemble<Real>::Integrate(const Real* h)
+{
+	const auto n = numInstances;
+	const auto two = (Real)2;
+	const auto X = x.data();
+	const auto Y = y.data();
+	const auto VX = vx.data();
+	const auto VY = vy.data();
+	const auto FX = fx.data();
+	const auto FY = fy.data();
+	const auto M = invMass.data();
+	const auto D = damping.data();
+
+	/* Calls f(o) for the offset o = p * n of every free point p */
+	const auto each_free_point = [&](const auto& f)
+	{
+		for (int p = 0; p < numPoints; p++)
+		{
+			if (!fixed[p])
+				f(p, (size_t)p * n);
+		}
+	};
+
+	const auto twophase = stepping == Scene::TWOPHASE;
+
+	switch (method)
+	{
+		case Scene::EULER:
+		{
+			SpringForces();
+
+			each_free_point([&](int, const size_t o)
+			{
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					const auto ax = (FX[o + k] - D[k] * VX[o + k]) * M[k];
+					const auto ay = (FY[o + k] - D[k] * VY[o + k]) * M[k];
+
+					X[o + k] += VX[o + k] * h[k];
+					Y[o + k] += VY[o + k] * h[k];
+					VX[o + k] += ax * h[k];
+					VY[o + k] += ay * h[k];
+				}
+			});
+			break;
+		}
+
+		case Scene::SYMPLECTIC:
+		{
+			const auto drift = [&](const size_t o)
+			{
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					X[o + k] += VX[o + k] * h[k];
+					Y[o + k] += VY[o + k] * h[k];
+				}
+			};
+
+			const auto kick = [&](const size_t o)
+			{
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					VX[o + k] += (FX[o + k] - D[k] * VX[o + k]) * M[k] * h[k];
+					VY[o + k] += (FY[o + k] - D[k] * VY[o + k]) * M[k] * h[k];
+				}
+			};
+
+			if (twophase)
+			{
+				each_free_point([&](int, const size_t o) { drift(o); });
+				SpringForces();
+				each_free_point([&](int, const size_t o) { kick(o); });
+			}
+			else
+			{
+				each_free_point([&](const int p, const size_t o)
+				{
+					drift(o);
+					PointForces(p);
+					kick(o);
+				});
+			}
+			break;
+		}
+
+		case Scene::LEAPFROG:
+		{
+			if (twophase)
+				SpringForces();
+
+			/* New velocity v(t) + h/2 a(t) of two phases */
+			const auto half_kick = [&](const size_t o)
+			{
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					const auto wx = VX[o + k] + h[k] / two * ((FX[o + k] - D[k] * VX[o + k]) * M[k]);
+					const auto wy = VY[o + k] + h[k] / two * ((FY[o + k] - D[k] * VY[o + k]) * M[k]);
+
+					X[o + k] += h[k] * wx;
+					Y[o + k] += h[k] * wy;
+					VX[o + k] = wx;
+					VY[o + k] = wy;
+				}
+			};
+
+			/* New velocity v(t - h/2) + h a(t) in place */
+			const auto kick = [&](const size_t o)
+			{
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					const auto ax = (FX[o + k] - D[k] * VX[o + k]) * M[k];
+					const auto ay = (FY[o + k] - D[k] * VY[o + k]) * M[k];
+
+					const auto wx = (VX[o + k] - h[k] / two * ax) + h[k] * ax;
+					const auto wy = (VY[o + k] - h[k] / two * ay) + h[k] * ay;
+
+					X[o + k] += h[k] * wx;
+					Y[o + k] += h[k] * wy;
+					VX[o + k] = wx;
+					VY[o + k] = wy;
+				}
+			};
+
+			if (twophase)
+			{
+				SpringForces();
+				each_free_point([&](int, const size_t o) { half_kick(o); });
+			}
+			else
+			{
+				each_free_point([&](const int p, const size_t o)
+				{
+					PointForces(p);
+					kick(o);
+				});
+			}
+			break;
+		}
+
+		case Scene::MIDPOINT:
+		{
+			const auto x0 = Stage(0, 0);
+			const auto y0 = Stage(0, 1);
+			const auto vx0 = Stage(0, 2);
+			const auto vy0 = Stage(0, 3);
+
+			/* v(t + h/2) and x(t + h/2) from a(t) */
+			const auto half = [&](const size_t o)
+			{
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					const auto ax = (FX[o + k] - D[k] * VX[o + k]) * M[k];
+					const auto ay = (FY[o + k] - D[k] * VY[o + k]) * M[k];
+
+					x0[o + k] = X[o + k];
+					y0[o + k] = Y[o + k];
+					vx0[o + k] = VX[o + k];
+					vy0[o + k] = VY[o + k];
+
+					VX[o + k] = vx0[o + k] + h[k] / two * ax;
+					VY[o + k] = vy0[o + k] + h[k] / two * ay;
+					X[o + k] = x0[o + k] + h[k] / two * VX[o + k];
+					Y[o + k] = y0[o + k] + h[k] / two * VY[o + k];
+				}
+			};
+
+			/* Full step with v and a at the midpoint */
+			const auto full = [&](const size_t o)
+			{
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					const auto ax = (FX[o + k] - D[k] * VX[o + k]) * M[k];
+					const auto ay = (FY[o + k] - D[k] * VY[o + k]) * M[k];
+
+					X[o + k] = x0[o + k] + h[k] * VX[o + k];
+					Y[o + k] = y0[o + k] + h[k] * VY[o + k];
+					VX[o + k] = vx0[o + k] + h[k] * ax;
+					VY[o + k] = vy0[o + k] + h[k] * ay;
+				}
+			};
+
+			if (twophase)
+			{
+				SpringForces();
+				each_free_point([&](int, const size_t o) { half(o); });
+				SpringForces();
+				each_free_point([&](int, const size_t o) { full(o); });
+			}
+			else
+			{
+				each_free_point([&](const int p, const size_t o)
+				{
+					PointForces(p);
+					half(o);
+					PointForces(p);
+					full(o);
+				});
+			}
+			break;
+		}
+
+		case Scene::VELOCITY_VERLET:
+		{
+			const auto kick = [&](const size_t o)
+			{
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					VX[o + k] += h[k] / two * ((FX[o + k] - D[k] * VX[o + k]) * M[k]);
+					VY[o + k] += h[k] / two * ((FY[o + k] - D[k] * VY[o + k]) * M[k]);
+				}
+			};
+
+			SpringForces();
+
+			each_free_point([&](int, const size_t o)
+			{
+				kick(o);
+
+				#pragma omp simd
+				for (int k = 0; k < n; k++)
+				{
+					X[o + k] += h[k] * VX[o + k];
+					Y[o + k] += h[k] * VY[o + k];
+				}
+			});
+
+			SpringForces();
+
+			each_free_point([&](int, const size_t o) { kick(o); });
+			break;
+		}
+
+		case Scene::RK2:
+			RungeKutta<rk2_tableau>(h);
+			break;
+
+		case Scene::RK4:
+			RungeKutta<rk4_tableau>(h);
+			break;
+
+		default:
+			break;
+	}
+}
+
+/******************************************************************
+*
+* Analytical
+*
+* Reference points of every sampled instance at its current time,
+* as in ReferenceSolution::Evaluate
+*
+*******************************************************************/
+
+template<class Real>
+void BasicEnsemble<Real>::Analytical()
+{
+	const auto n = numInstances;
+
+	/* Damped oscillation of every instance at its time; it does not
+	   depend on the spring */
+	#pragma omp simd
+	for (int k = 0; k < n; k++)
+		shape[k] = reference_shape(wr[k], wbar[k], ratio[k], time[k]);
+
+	for (int p = 0; p < numPoints; p++)
+	{
+		if (fixed[p])
+			continue;
+
+		const auto o = (size_t)p * n;
+
+		for (auto it = adjacency.begin(p); it != adjacency.end(p); ++it)
+		{
+			const auto q = (size_t)it->other * n;
+			const auto l = referenceLength[it->spring];
+
+			#pragma omp simd
+			for (int k = 0; k < n; k++)
+			{
+				const auto cx = rx[q + k] - rx[o + k];
+				const auto cy = ry[q + k] - ry[o + k];
+
+				const auto length = sqrt(cx * cx + cy * cy);
+				const auto dx = cx / length;
+				const auto dy = cy / length;
+
+				const auto s = reference_offset(dy, scale[k], shape[k], l);
+
+				/* Instances between samples keep their reference */
+				rx[o + k] = sampled[k] ? rx[q + k] + s * dx : rx[o + k];
+				ry[o + k] = sampled[k] ? ry[q + k] + s * dy : ry[o + k];
+			}
+		}
+	}
+}
+
+/* RMS distance to the reference of all instances that were sampled */
+template<class Real>
+void BasicEnsemble<Real>::Compare()
+{
+	const auto n = numInstances;
+
+	vector<double> sum(n, 0.0);
+
+	for (int p = 0; p < numPoints; p++)
+	{
+		const auto o = (size_t)p * n;
+
+		#pragma omp simd
+		for (int k = 0; k < n; k++)
+		{
+			const auto dx = rx[o + k] - x[o + k];
+			const auto dy = ry[o + k] - y[o + k];
+
+			sum[k] += dx * dx + dy * dy;
+		}
+	}
+
+	/* Branches and calls per instance, so not vectorized */
+	for (int k = 0; k < n; k++)
+	{
+		if (taken[k] >= steps[k] || diverged[k])
+			continue;
+
+		taken[k]++;
+
+		if (!sampled[k])
+			continue;
+
+		const auto rms = sqrt(sum[k] / numPoints);
+
+		error[k].Add(rms);
+
+		if (recordSeries)
+		{
+			series[k].push_back(time[k]);
+			series[k].push_back(rms);
+		}
+
+		/* Freeze instances that blew up */
+		if (!isfinite(rms))
+			diverged[k] = 1;
+	}
+}
+
+template<class Real>
+void BasicEnsemble<Real>::Run(const double duration)
+{
+	const auto n = numInstances;
+
+	auto iterations = 0L;
+
+	for (int k = 0; k < n; k++)
+	{
+		steps[k] = (long)llround(duration / step[k]);
+		iterations = max(iterations, steps[k]);
+
+		if (recordSeries)
+			series[k].reserve(2 * (steps[k] / interval));
+	}
+
+	vector<Real> h(n);
+
+	for (long i = 0; i < iterations; i++)
+	{
+		auto active = false;
+
+		for (int k = 0; k < n; k++)
+		{
+			const auto live = taken[k] < steps[k] && !diverged[k];
+
+			h[k] = live ? (Real)step[k] : (Real)0;
+			time[k] += h[k];
+			sampled[k] = live && (taken[k] + 1) % interval == 0;
+			active = active || live;
+		}
+
+		if (!active)
+			break;
+
+		Integrate(h.data());
+		Analytical();
+		Compare();
+	}
+}
+
+template class BasicEnsemble<double>;
+template class BasicEnsemble<float>;
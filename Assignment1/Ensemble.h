@@ -0,0 +1,160 @@
+/******************************************************************
+*
+* Ensemble.h
+*
+* Description: Lockstep simulation of many independent instances of
+* one analytical test case (spring1D, hanging, falling); every
+* instance has its own mass, stiffness, damping and step size.
+*
+* All instances share the topology. The state is stored with the
+* instance as innermost dimension, x[point * instances + instance],
+* so every point and spring update is a loop over contiguous
+* instances that the compiler vectorizes. An instance takes
+* llround(duration / step) steps and is frozen afterwards, or as
+* soon as its error is no longer finite. Like a scene, the ensemble
+* compares with the analytical solution every interval steps.
+*
+* The scalar type of the simulated state (positions, velocities,
+* forces, stages, masses and springs) is a template parameter; the
+* float ensemble fits twice the instances into a vector register and
+* moves half the memory. Time, the analytical reference and the error
+* stay double, so the error of a float ensemble is the error of its
+* state alone.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __ENSEMBLE_H__
+#define __ENSEMBLE_H__
+
+#include <vector>
+using namespace std;
+
+#include "Scene.h"
+#include "SimulationState.h"
+
+/* Parameters of one instance */
+struct EnsembleMember
+{
+	double mass;
+	double stiffness;
+	double damping;
+	double step;
+};
+
+template<class Real>
+class BasicEnsemble
+{
+private:
+	Scene::Method method;
+	Scene::Stepping stepping;
+
+	int numInstances;
+	int numPoints;
+
+	/* Topology of the test case, shared by all instances */
+	vector<int> i0, i1;             /* End points per spring */
+	vector<Real> restLength;        /* Rest length per spring */
+	vector<double> referenceLength; /* Rest length of the analytical solution */
+	vector<char> fixed;             /* Per point */
+	Adjacency adjacency;
+
+	/* Per instance */
+	vector<Real> mass, invMass, stiffness, damping;
+	vector<double> step;
+	vector<double> wr, wbar, ratio; /* Decay rate, damped frequency, wr / wbar */
+	vector<double> scale;           /* m g / k */
+	vector<double> shape;           /* E(t) - 1 of the current time, see ReferenceSolution.h */
+	vector<double> time;
+	vector<long> steps;             /* Steps to take */
+	vector<long> taken;             /* Steps taken so far */
+	vector<char> sampled;           /* Compared in the current step */
+	vector<char> diverged;
+	int interval;                   /* Steps between comparisons */
+	vector<ErrorStats> error;
+	vector<vector<double>> series;  /* time, rms per step, if recorded */
+	bool recordSeries;
+
+	/* Per point and instance */
+	vector<Real> x, y, vx, vy, fx, fy;
+	vector<double> rx, ry;          /* Analytical reference */
+	vector<Real> stage;             /* Saved state and stages, see Stage() */
+
+	Real* Stage(int slot, int component)
+	{
+		return &stage[((size_t)slot * 4 + component) * numPoints * numInstances];
+	}
+
+	void SpringForces();
+	void PointForces(int p);
+	void Integrate(const Real* h);
+	template<const auto& T> void RungeKutta(const Real* h);
+	void Analytical();
+	void Compare();
+
+public:
+	BasicEnsemble(Scene::Method _method, Scene::Testcase testcase, Scene::Stepping _stepping,
+	              const vector<EnsembleMember>& members, bool _recordSeries);
+
+	/* Explicit fixed-step methods only; no implicit solve, no step control */
+	static bool IsSupported(Scene::Method m);
+
+	/* Compare with the analytical solution every k steps */
+	void SetErrorInterval(int k)
+	{
+		interval = k;
+	}
+
+	/* Step all instances until each has simulated duration */
+	void Run(double duration);
+
+	int Size() const
+	{
+		return numInstances;
+	}
+
+	int GetNumPoints() const
+	{
+		return numPoints;
+	}
+
+	const ErrorStats& GetError(int k) const
+	{
+		return error[k];
+	}
+
+	long GetSteps(int k) const
+	{
+		return taken[k];
+	}
+
+	double GetTime(int k) const
+	{
+		return time[k];
+	}
+
+	bool IsDiverged(int k) const
+	{
+		return diverged[k] != 0;
+	}
+
+	/* Time and RMS error of every sampled step of instance k, pairwise */
+	const vector<double>& GetSeries(int k) const
+	{
+		return series[k];
+	}
+};
+
+/* Instantiated in Ensemble.cpp */
+extern template class BasicEnsemble<double>;
+extern template class BasicEnsemble<float>;
+
+typedef BasicEnsemble<double> Ensemble;
+typedef BasicEnsemble<float> EnsembleF32;
+
+#endif
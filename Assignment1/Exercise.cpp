@@ -2,12 +2,23 @@
 *
 * Exercise.cpp  
 *
-* Description: In this file - in the function TimeStep() - the various 
-* numerical solvers of the first programming assignment have to be
-* implemented. Feel free to add new local functions into this file. 
-* Changes to other source files of the framework should not be 
-* required. It is acceptable to assume knowledge about the scene
-* topology (i.e. how springs and points are connected).
+* Description: Time integrators of the mass-spring system and their
+* selection in GetStepFunction(). The explicit schemes (in-place and
+* two-phase), velocity Verlet and the Runge-Kutta methods of
+* ButcherTableau.h live here, together with the per-point and
+* spring-centric force passes, contact resolution and the comparison
+* with the analytical reference after every step.
+*
+* The other solvers have files of their own: the linear solve of
+* implicit Euler in ImplicitEuler.cpp, the constraint projection of
+* XPBD in XpbdSolver.cpp, the SIMD spring force kernels in
+* SpringKernel.cpp, contacts in ContactGrid.cpp and ContactSolver.cpp
+* and the closed-form reference in ReferenceSolution.cpp. Their
+* loops run on the task pool of TaskPool.h.
+*
+* All schemes are templates on the scalar type of the points; scenes
+* stepped with -precision float use the float instantiations, which
+* still compare against the double analytical reference.
 *
 * Physically-Based Simulation Proseminar WS 2015
 * 
@@ -21,410 +32,1127 @@
 #include <vector>
 #include <random>
 #include <cassert>
-#include <fstream>
-#include <array>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
 
 using namespace std;
 
 /* Local includes */
 #include "Vec2.h"
 #include "Scene.h"
+#include "ParticleSystem.h"
+#include "Adjacency.h"
+#include "SpringColoring.h"
+#include "SimulationState.h"
+#include "ImplicitEuler.h"
+#include "SpringKernel.h"
+#include "ButcherTableau.h"
+#include "PhaseTimers.h"
+#include "TaskPool.h"
+
+
+
+template<class Real>
+BasicVec2<Real> compute_internal_forces(const int i,
+                                        const BasicParticleSystem<Real>& particles,
+                                        const vector<BasicSpring<Real>>& springs,
+                                        const Adjacency& adjacency)
+{
+	auto force = BasicVec2<Real>(0, 0);
 
+	const auto pos = particles.GetPos(i);
 
+	for (auto it = adjacency.begin(i); it != adjacency.end(i); ++it)
+	{
+		const auto& spring = springs[it->spring];
 
-auto& get_time()
-{
-    static auto t = 0.0;
+		const auto connection =
+			pos - particles.GetPos(it->other);
+
+		const auto distance = connection.length();
+
+		if (abs(distance) < 0.00000001)
+			continue;
 
-    return t;
+		const auto direction = connection.normalize();
+
+		force += spring.getStiffness() *
+			(spring.getRestLength() - distance) * direction;
+	}
+
+	return force;
 }
 
-auto& update_time(const double dt)
+template<class Real>
+BasicVec2<Real> compute_acceleration(const int i, const BasicParticleSystem<Real>& particles)
 {
-    return get_time() += dt;
+	return (particles.GetForce(i) - particles.damping[i] * particles.GetVel(i)) *
+		particles.invMass[i];
 }
 
-
-void print_headers(ostream& os)
+template<class Real>
+void update_forces(const int i,
+                   BasicParticleSystem<Real>& particles,
+                   const vector<BasicSpring<Real>>& springs,
+                   const Adjacency& adjacency)
 {
-    static constexpr array<char*, 2> headers =
-    {
-        "t,", "rms"
-    };
-    
-    for(const auto header : headers)
-    {
-        os << header;
-    }
+	// internal forces
+	const auto force = compute_internal_forces(i, particles, springs, adjacency);
 
-    os << "\n";
+	// external forces
+	particles.fx[i] = force.x + particles.ux[i];
+	particles.fy[i] = force.y + particles.uy[i];
 }
 
-ostream& get_stream()
+template<class Real>
+BasicVec2<Real> compute_acceleration(const int i,
+                                     BasicParticleSystem<Real>& particles,
+                                     const vector<BasicSpring<Real>>& springs,
+                                     const Adjacency& adjacency)
 {
-    static fstream stream = []()
-    {
-        fstream s("./lastrun.log", ios_base::out);
+	update_forces(i, particles, springs, adjacency);
+	return compute_acceleration(i, particles);
+}
+
+/******************************************************************
+*
+* accumulate_spring_forces
+*
+* Spring-centric force pass: initializes every force with the user
+* force and visits every spring exactly once, adding equal and
+* opposite forces to its end points (SpringKernel.cpp). Springs of one color share no
+* end points and are scattered in parallel by the task pool, in
+* chunks that start at the same springs with any number of threads;
+* colors are processed in a fixed order, so the summation order (and
+* result) does not depend on the number of threads.
+*
+*******************************************************************/
+
+template<class Real>
+void accumulate_spring_forces(BasicParticleSystem<Real>& particles,
+                              const BasicSpringColoring<Real>& coloring)
+{
+	/* Fastest kernel of this CPU, picked once */
+	static const auto kernel = GetSpringKernel<Real>(GetBestSpringKernel());
+	static const auto scalar = GetSpringKernel<Real>(KERNEL_SCALAR);
+
+	/* Springs per parallel work item, multiple of every vector width */
+	static constexpr auto chunk = 1024;
+
+	ScopedPhaseTimer timer(PHASE_FORCES);
 
-        const auto loc = locale("");
+	const auto n = particles.Size();
 
-        s.imbue(loc);
+	const auto init = [&](const int begin, const int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			particles.fx[i] = particles.ux[i];
+			particles.fy[i] = particles.uy[i];
+		}
+	};
 
-      //  print_headers(s);
+	ParallelRanges(n, init);
 
-        return s;
-    }();
+	for (int c = 0; c < coloring.GetNumColors(); c++)
+	{
+		const auto first = coloring.First(c);
+		const auto last = coloring.Last(c);
+
+		if (coloring.IsSerial(c))
+		{
+			scalar(particles, coloring, first, last);
+			continue;
+		}
 
-    return stream;
+		/* Ranges are whole chunks counted from first, each passed to
+		   the kernel on its own */
+		const auto scatter = [&](const int begin, const int end)
+		{
+			for (int j = begin; j < end; j += chunk)
+				kernel(particles, coloring, j, min(j + chunk, end));
+		};
+
+		if (last - first > parallel_springs)
+			ParallelFor(first, last, chunk, scatter);
+		else
+			scatter(first, last);
+	}
 }
 
+/* Also timed on their own by the micro benchmarks (Bench.cpp) */
+template Vec2 compute_internal_forces(int, const ParticleSystem&,
+                                      const vector<Spring>&, const Adjacency&);
+template Vec2f compute_internal_forces(int, const ParticleSystemF32&,
+                                       const vector<SpringF32>&, const Adjacency&);
+template void accumulate_spring_forces(ParticleSystem&, const SpringColoring&);
+template void accumulate_spring_forces(ParticleSystemF32&, const SpringColoringF32&);
+
+template<class Real>
+void apply_external_forces(const int i, BasicParticleSystem<Real>& particles,
+                           default_random_engine& rng, const bool interaction)
+{
+    static uniform_real_distribution<> rnd(-50, 50);
+
+    // gravity
+    static constexpr auto g = -10;
+
+    particles.ux[i] = 0.0;
+    particles.uy[i] = particles.GetMass(i) * g;
+
+    if (interaction)
+    {
+        particles.ux[i] += (Real)rnd(rng);
+        particles.uy[i] += (Real)abs(rnd(rng));
+    }
+}
 
-void reset_time(const double dt)
+/* Data-parallel loop over all free points on the task pool; f(i)
+   must only write to point i */
+template<class Real, class F>
+void for_each_free_point(const BasicParticleSystem<Real>& particles, const F& f)
 {
-    update_time(-get_time());
-    get_stream().flush().seekp(0.0);
+    ParallelForEach(particles.Size(), [&](const int i)
+    {
+        if (!particles.IsFixed(i))
+            f(i);
+    });
 }
 
-void print_value()
+template<class Real>
+void apply_external_forces(BasicParticleSystem<Real>& particles,
+                           default_random_engine& rng, const bool interaction)
 {
-    get_stream() << endl;
+    for (auto i = 0; i < particles.Size(); i++)
+    {
+        if (!particles.IsFixed(i))
+            apply_external_forces(i, particles, rng, interaction);
+    }
 }
 
-template<class T>
-void print_value(const T& value)
+template<class Real, class F>
+void apply_method(BasicParticleSystem<Real>& particles,
+    default_random_engine& rng,
+    const bool interaction, 
+    const F& method)
 {
-    get_stream() << value;
+    apply_external_forces(particles, rng, interaction);
+
+    for (auto i = 0; i < particles.Size(); i++)
+    {
+        if (particles.IsFixed(i))
+            continue;
+
+        method(i);
+    }
 }
 
-template<class T, class...Ts>
-void print(const T& value, Ts&&...rest)
+/* The reference is kept in double, also for scenes stepped in float */
+template<class Real>
+void compare(const ParticleSystem& expected, const BasicParticleSystem<Real>& actual,
+             SimulationState& state)
 {
-    print_value(value);
+    assert(expected.Size() == actual.Size());
+
+    auto pos_error = 0.0;
+
+    for(auto i = 0; i < expected.Size(); i++)
+    {
+        const auto dx = expected.x[i] - actual.x[i];
+        const auto dy = expected.y[i] - actual.y[i];
+
+        pos_error += dx * dx + dy * dy;
+    }
+
+    const auto rms = sqrt(pos_error / expected.Size());
+
+    state.error.Add(rms);
+}
 
-    if constexpr(sizeof...(rest) > 0)
+/* Runs update(interaction) and, if requested, advances and compares
+   against the analytical reference every sampling interval steps; dt
+   is the length of the following steps, 0 for adaptive methods */
+template<bool Compare, class Real, class U>
+void with_reference(const double dt,
+                    BasicParticleSystem<Real>& particles,
+                    const vector<BasicSpring<Real>>& springs,
+                    const Adjacency& adjacency,
+                    SimulationState& state,
+                    const bool interaction,
+                    const U& update)
+{
+    if constexpr (Compare)
     {
-        print_value(";");
-        print(std::forward<Ts>(rest)...);
+        if (!state.hasReference)
+        {
+            state.reference.Assign(particles);
+            state.hasReference = true;
+        }
+
+        {
+            ScopedPhaseTimer timer(PHASE_INTEGRATE);
+            update(false);
+        }
+
+        auto& sampling = state.sampling;
+
+        sampling.sampled = ++sampling.phase >= sampling.interval;
+
+        if (!sampling.sampled)
+            return;
+
+        sampling.phase = 0;
+
+        ScopedPhaseTimer timer(PHASE_REFERENCE);
+
+        state.solution.Evaluate(state.time, dt, sampling.interval, state.reference);
+
+        compare(state.reference, particles, state);
     }
     else
     {
-        print_value();
+        ScopedPhaseTimer timer(PHASE_INTEGRATE);
+        update(interaction);
     }
 }
 
-Point& get_other_spring_end(const Point& point, const Spring& spring)
+template<bool Compare, class Real, class F>
+void apply_method(const double dt,
+                  BasicParticleSystem<Real>& particles,
+                  const vector<BasicSpring<Real>>& springs,
+                  const Adjacency& adjacency,
+                  SimulationState& state,
+                  const bool interaction,
+                  const F& method)
+{
+    with_reference<Compare>(dt, particles, springs, adjacency, state, interaction,
+        [&](const bool external)
+    {
+        apply_method(particles, state.rng, external, method);
+    });
+}
+
+/******************************************************************
+*
+* apply_phases
+*
+* Two-phase stepping: external forces are set for all points, then
+* phases() runs the integrator as a sequence of whole-system passes -
+* forces are evaluated from one frozen state, then every point is
+* updated in a data-parallel loop
+*
+*******************************************************************/
+
+template<bool Compare, class Real, class F>
+void apply_phases(const double dt,
+                  BasicParticleSystem<Real>& particles,
+                  const vector<BasicSpring<Real>>& springs,
+                  const Adjacency& adjacency,
+                  SimulationState& state,
+                  const bool interaction,
+                  const F& phases)
 {
-    return spring.getPoint(0) == &point
-        ? *spring.getPoint(1)
-        : *spring.getPoint(0);
+    with_reference<Compare>(dt, particles, springs, adjacency, state, interaction,
+        [&](const bool external)
+    {
+        apply_external_forces(particles, state.rng, external);
+
+        phases();
+    });
 }
 
-Vec2 compute_internal_forces(const Point& point, const vector<Spring>& springs)
+template<class Real, bool Compare>
+void euler(const double dt,
+           BasicParticleSystem<Real>& particles,
+           const vector<BasicSpring<Real>>& springs,
+           const Adjacency& adjacency,
+           const BasicSpringColoring<Real>&,
+           SimulationState& state,
+           const bool interaction)
 {
-	auto force = Vec2(0.0, 0.0);
+    const auto h = (Real)dt;
 
-	for (auto& spring : springs)
-	{
-		if (spring.getPoint(0) != &point &&
-			spring.getPoint(1) != &point)
-		{
-			continue;
-		}
+    apply_method<Compare>(dt, particles, springs, adjacency, state, interaction,
+        [&](const int i)
+    {
+        // x(t + h) = x(t) + h * v(t)
+        // v(t + h) = v(t) + h * a(t)
 
-		const auto spring_point = spring.getPoint(0) == &point
-			? spring.getPoint(1)
-			: spring.getPoint(0);
+        const auto new_position = particles.GetPos(i) + particles.GetVel(i) * h;
+        const auto a = compute_acceleration(i, particles, springs, adjacency);
 
-		const auto connection =
-			point.getPos() - spring_point->getPos();
+        particles.SetPos(i, new_position);
+        particles.SetVel(i, particles.GetVel(i) + a * h);
+    });
+}
 
-		const auto distance = connection.length();
+template<class Real, bool Compare>
+void symplectic(const double dt,
+				BasicParticleSystem<Real>& particles,
+                const vector<BasicSpring<Real>>& springs,
+                const Adjacency& adjacency,
+                const BasicSpringColoring<Real>&,
+                SimulationState& state,
+				const bool interaction)
+{
+    const auto h = (Real)dt;
 
-		if (abs(distance) < 0.00000001)
-			continue;
+    apply_method<Compare>(dt, particles, springs, adjacency, state, interaction,
+        [&](const int i)
+    {
+        // x(t + h) = x(t) + h * v(t)
+        // v(t + h) = v(t) + h * a(t + h)
 
-		const auto direction = connection.normalize();
+        particles.SetPos(i, particles.GetPos(i) + particles.GetVel(i) * h);
 
-		force += spring.getStiffness() *
-			(spring.getRestLength() - distance) * direction;
-	}
+        const auto a = compute_acceleration(i, particles, springs, adjacency);
 
-	return force;
+        particles.SetVel(i, particles.GetVel(i) + a * h);
+    });
 }
 
-Vec2 compute_acceleration(const Point& point)
+template<class Real, bool Compare>
+void midpoint(const double dt, 
+			  BasicParticleSystem<Real>& particles, 
+              const vector<BasicSpring<Real>>& springs,
+              const Adjacency& adjacency,
+              const BasicSpringColoring<Real>&,
+              SimulationState& state,
+	          const bool interaction)
 {
-	return (point.getForce() - point.getDamping() * point.getVel()) /
-		point.getMass();
+    const auto h = (Real)dt;
+
+    apply_method<Compare>(dt, particles, springs, adjacency, state, interaction,
+        [&](const int i)
+    {
+        const auto a = compute_acceleration(i, particles, springs, adjacency);
+
+        const auto original_velocity = particles.GetVel(i);
+
+        particles.SetVel(i, original_velocity + h / 2 * a);
+
+        const auto original_position = particles.GetPos(i);
+
+        particles.SetPos(i, original_position + h / 2 * particles.GetVel(i));
+
+        const auto a_new = compute_acceleration(i, particles, springs, adjacency);
+
+        particles.SetPos(i, original_position + h * particles.GetVel(i));
+
+        particles.SetVel(i, original_velocity + h * a_new);
+    });
 }
 
-void update_forces(Point& point, const vector<Spring>& springs)
+template<class Real, bool Compare>
+void leapfrog(const double dt, 
+			  BasicParticleSystem<Real>& particles, 
+			  const vector<BasicSpring<Real>>& springs, 
+              const Adjacency& adjacency,
+              const BasicSpringColoring<Real>&,
+              SimulationState& state,
+	          const bool interaction)
 {
-	// internal forces
-	point.setForce(compute_internal_forces(point, springs));
+    const auto h = (Real)dt;
 
-	// external forces
-	point.addForce(point.getUserForce());
+    apply_method<Compare>(dt, particles, springs, adjacency, state, interaction,
+        [&](const int i)
+    {
+        const auto a = compute_acceleration(i, particles, springs, adjacency);
+
+        const auto old_velocity = particles.GetVel(i) - h / 2 * a;
+
+        const auto new_velocity = old_velocity + h * a;
+
+        particles.SetPos(i, particles.GetPos(i) + h * new_velocity);
+
+        particles.SetVel(i, new_velocity);
+    });
 }
 
-Vec2 compute_acceleration(Point& point, const vector<Spring>& springs)
+template<class Real, bool Compare>
+void implicit_euler(const double dt,
+                    BasicParticleSystem<Real>& particles,
+                    const vector<BasicSpring<Real>>& springs,
+                    const Adjacency& adjacency,
+                    const BasicSpringColoring<Real>& coloring,
+                    SimulationState& state,
+                    const bool interaction)
 {
-	update_forces(point, springs);
-	return compute_acceleration(point);
+    const auto h = (Real)dt;
+
+    // v(t + h) = v(t) + dv, with (M - h D - h^2 K) dv = h (f + h K v)
+    // x(t + h) = x(t) + h * v(t + h)
+    apply_phases<Compare>(dt, particles, springs, adjacency, state, interaction, [&]()
+    {
+        accumulate_spring_forces(particles, coloring);
+
+        state.implicit.Solve(dt, particles, springs, adjacency);
+
+        for_each_free_point(particles, [&](const int i)
+        {
+            particles.vx[i] += (Real)state.implicit.dvx[i];
+            particles.vy[i] += (Real)state.implicit.dvy[i];
+
+            particles.SetPos(i, particles.GetPos(i) + particles.GetVel(i) * h);
+        });
+    });
 }
 
-void apply_external_forces(Point& point, const bool interaction)
+template<class Real, bool Compare>
+void xpbd(const double dt,
+          BasicParticleSystem<Real>& particles,
+          const vector<BasicSpring<Real>>& springs,
+          const Adjacency& adjacency,
+          const BasicSpringColoring<Real>& coloring,
+          SimulationState& state,
+          const bool interaction)
 {
-    static default_random_engine rng;
-    static uniform_real_distribution<> rnd(-50, 50);
+    // springs as compliant distance constraints, projected in
+    // substeps of dt; velocities follow from the positions
+    apply_phases<Compare>(dt, particles, springs, adjacency, state, interaction, [&]()
+    {
+        state.xpbd.Step(dt, particles, coloring);
+    });
+}
 
-    // gravity
-    static constexpr auto g = -10;
+/* Two-phase variants of the explicit schemes; same update formulas
+   as above, but every force pass sees one consistent state */
+
+template<class Real, bool Compare>
+void euler_phases(const double dt,
+                  BasicParticleSystem<Real>& particles,
+                  const vector<BasicSpring<Real>>& springs,
+                  const Adjacency& adjacency,
+                  const BasicSpringColoring<Real>& coloring,
+                  SimulationState& state,
+                  const bool interaction)
+{
+    const auto h = (Real)dt;
+
+    apply_phases<Compare>(dt, particles, springs, adjacency, state, interaction, [&]()
+    {
+        accumulate_spring_forces(particles, coloring);
 
-    point.setUserForce(Vec2(0, point.getMass() * g));
+        for_each_free_point(particles, [&](const int i)
+        {
+            const auto a = compute_acceleration(i, particles);
 
-    if (interaction)
+            particles.SetPos(i, particles.GetPos(i) + particles.GetVel(i) * h);
+            particles.SetVel(i, particles.GetVel(i) + a * h);
+        });
+    });
+}
+
+template<class Real, bool Compare>
+void symplectic_phases(const double dt,
+                       BasicParticleSystem<Real>& particles,
+                       const vector<BasicSpring<Real>>& springs,
+                       const Adjacency& adjacency,
+                       const BasicSpringColoring<Real>& coloring,
+                       SimulationState& state,
+                       const bool interaction)
+{
+    const auto h = (Real)dt;
+
+    apply_phases<Compare>(dt, particles, springs, adjacency, state, interaction, [&]()
     {
-        point.setUserForce(point.getUserForce() + Vec2(
-            rnd(rng), abs(rnd(rng))));
-    }
+        for_each_free_point(particles, [&](const int i)
+        {
+            particles.SetPos(i, particles.GetPos(i) + particles.GetVel(i) * h);
+        });
+
+        accumulate_spring_forces(particles, coloring);
+
+        for_each_free_point(particles, [&](const int i)
+        {
+            particles.SetVel(i, particles.GetVel(i) + compute_acceleration(i, particles) * h);
+        });
+    });
 }
 
-template<class F>
-void apply_method(vector<Point>& points, 
-    const bool interaction, 
-    const F& method)
+template<class Real, bool Compare>
+void leapfrog_phases(const double dt,
+                     BasicParticleSystem<Real>& particles,
+                     const vector<BasicSpring<Real>>& springs,
+                     const Adjacency& adjacency,
+                     const BasicSpringColoring<Real>& coloring,
+                     SimulationState& state,
+                     const bool interaction)
 {
-    for (auto& point : points)
+    const auto h = (Real)dt;
+
+    apply_phases<Compare>(dt, particles, springs, adjacency, state, interaction, [&]()
     {
-        if (point.isFixed())
-            continue;
+        accumulate_spring_forces(particles, coloring);
 
-        apply_external_forces(point, interaction);
+        for_each_free_point(particles, [&](const int i)
+        {
+            const auto a = compute_acceleration(i, particles);
 
-        method(point);
-    }
+            const auto new_velocity = particles.GetVel(i) + h / 2 * a;
+
+            particles.SetPos(i, particles.GetPos(i) + h * new_velocity);
+            particles.SetVel(i, new_velocity);
+        });
+    });
 }
 
-void analytical(const double dt,
-                vector<Point>& points,
-                const vector<Spring>& springs)
-            {
-                static constexpr auto g = -10.0;
+template<class Real, bool Compare>
+void midpoint_phases(const double dt,
+                     BasicParticleSystem<Real>& particles,
+                     const vector<BasicSpring<Real>>& springs,
+                     const Adjacency& adjacency,
+                     const BasicSpringColoring<Real>& coloring,
+                     SimulationState& state,
+                     const bool interaction)
+{
+    const auto h = (Real)dt;
 
-                const auto t = get_time();
+    auto& start = state.GetStage<Real>();
 
-                apply_method(points, false, [&](auto& point)
-                {
-                    const auto m = point.getMass();
-                    const auto d = point.getDamping();
+    apply_phases<Compare>(dt, particles, springs, adjacency, state, interaction, [&]()
+    {
+        accumulate_spring_forces(particles, coloring);
 
-                    const auto wr = d / (2 * m);
+        // remember x(t), v(t) and move every point to the midpoint
+        start.resize(4 * particles.Size());
 
-                    for (const auto& spring : springs)
-                    {
-                        if (spring.getPoint(0) != &point &&
-                            spring.getPoint(1) != &point)
-                        {
-                            continue;
-                        }
+        for_each_free_point(particles, [&](const int i)
+        {
+            const auto a = compute_acceleration(i, particles);
 
-                        const auto& spring_point = get_other_spring_end(point, spring);
+            auto s = &start[4 * i];
+            s[0] = particles.x[i];
+            s[1] = particles.y[i];
+            s[2] = particles.vx[i];
+            s[3] = particles.vy[i];
 
-                        const auto connection =
-                            spring_point.getPos() - point.getPos();
+            particles.SetVel(i, BasicVec2<Real>(s[2], s[3]) + h / 2 * a);
+            particles.SetPos(i, BasicVec2<Real>(s[0], s[1]) + h / 2 * particles.GetVel(i));
+        });
 
-                        const auto direction = connection.normalize();
+        accumulate_spring_forces(particles, coloring);
+
+        for_each_free_point(particles, [&](const int i)
+        {
+            const auto a_new = compute_acceleration(i, particles);
+
+            const auto s = &start[4 * i];
+
+            particles.SetPos(i, BasicVec2<Real>(s[0], s[1]) + h * particles.GetVel(i));
+            particles.SetVel(i, BasicVec2<Real>(s[2], s[3]) + h * a_new);
+        });
+    });
+}
 
-                        const auto actual_gravity = g * abs(direction.y);
+/******************************************************************
+*
+* velocity_verlet
+*
+* x(t + h) = x(t) + h v(t) + h^2 / 2 a(t)
+* v(t + h) = v(t) + h / 2 (a(t) + a(t + h))
+*
+* The damping force in a(t + h) is evaluated with the half-step
+* velocity v(t) + h / 2 a(t). Always runs in two phases.
+*
+*******************************************************************/
 
-                        const auto l = spring.getRestLength();
-                        const auto k = spring.getStiffness();
+template<class Real, bool Compare>
+void velocity_verlet(const double dt,
+                     BasicParticleSystem<Real>& particles,
+                     const vector<BasicSpring<Real>>& springs,
+                     const Adjacency& adjacency,
+                     const BasicSpringColoring<Real>& coloring,
+                     SimulationState& state,
+                     const bool interaction)
+{
+    const auto h = (Real)dt;
 
-                        const auto x0 = -l;
+    apply_phases<Compare>(dt, particles, springs, adjacency, state, interaction, [&]()
+    {
+        accumulate_spring_forces(particles, coloring);
 
-                        const auto w = sqrt(k / m);
+        // half kick and drift
+        for_each_free_point(particles, [&](const int i)
+        {
+            const auto a = compute_acceleration(i, particles);
 
-                        // ensure under-damping
-                        assert(wr * wr  < w * w &&
-                            point.getDamping() < 2 * sqrt(m * spring.getStiffness()));
+            particles.SetVel(i, particles.GetVel(i) + h / 2 * a);
+            particles.SetPos(i, particles.GetPos(i) + h * particles.GetVel(i));
+        });
 
-                        const auto wbar = sqrt(w * w - wr * wr);
+        accumulate_spring_forces(particles, coloring);
 
-                        const auto a = m * actual_gravity / k;
-                        const auto b = a * (wr / wbar);
+        // second half kick with the forces at x(t + h)
+        for_each_free_point(particles, [&](const int i)
+        {
+            particles.SetVel(i, particles.GetVel(i) + h / 2 * compute_acceleration(i, particles));
+        });
+    });
+}
 
-                        // update position --------------------------------------------------------------
-                        const auto x = exp(-wr * t) * (a*cos(wbar * t) + b *sin(wbar * t)) -
-                            m * actual_gravity / k + x0;
+/******************************************************************
+*
+* runge_kutta
+*
+* Explicit Runge-Kutta method given by a Butcher tableau on the whole
+* system y = (x, v), f(y) = (v, a):
+*
+* k_s = f(y0 + h sum_j a[s][j] k_j),  y(t + h) = y0 + h sum_s b[s] k_s
+*
+* Every stage is one force pass followed by one loop over the points,
+* which stores k_s and immediately moves the point to the input of
+* the next stage, so no extra pass combines the stages. The stages
+* are unrolled at compile time with the coefficients as constants.
+* Per point, state.stage holds y0 and k_1 .. k_S, each (x, y, vx, vy).
+*
+*******************************************************************/
 
-                        point.setPos(spring_point.getPos() + x * direction);
-                    }
-                });
-            }
+template<const auto& T>
+constexpr int rk_stride = 4 * (remove_reference_t<decltype(T)>::stages + 1);
 
-void compare(const vector<Point>& expected, const vector<Point>& actual)
+/* Stage buffer of n points; grows only, so a scene allocates once.
+   Returns true, if it was (re)allocated */
+template<class Real>
+static bool reserve_stages(SimulationState& state, const int stride, const int n)
 {
-    assert(expected.size() == actual.size());
+    auto& stage = state.GetStage<Real>();
+    const auto size = (size_t)stride * n;
 
-    auto pos_error = 0.0;
+    if (stage.size() >= size)
+        return false;
 
-    for(auto i = 0u; i < expected.size(); i++)
-    {
-        pos_error += (expected[i].getPos() - actual[i].getPos()).length_sq();
-    }
+    stage.resize(size);
 
-    print(get_time(), sqrt(pos_error / expected.size()));
+    return true;
 }
 
-template<bool Compare, class F>
-void apply_method(const double dt,
-                  vector<Point>& points,
-                  const vector<Spring>& springs,
-                  const bool interaction,
-                  const F& method)
+/* Stage s of point i: k_s into slot s + 1, then particles = next stage
+   input (or the new state after the last stage); start saves y0 first,
+   evaluate = false reuses k_0 of the slot */
+template<const auto& T, int s, class Real>
+inline void runge_kutta_point(const int i, const double h, BasicParticleSystem<Real>& particles,
+                              Real* const st, const bool start, const bool evaluate)
 {
-    if constexpr (Compare)
-    {
-        static auto reference_points = points;
+    constexpr auto S = remove_reference_t<decltype(T)>::stages;
+    constexpr const double* w = s + 1 < S ? T.a[s + 1] : T.b;
 
-        apply_method(points, false, method);
+    if (s == 0 && start)
+    {
+        st[0] = particles.x[i];
+        st[1] = particles.y[i];
+        st[2] = particles.vx[i];
+        st[3] = particles.vy[i];
+    }
 
-        analytical(dt, reference_points, springs);
+    if (s > 0 || evaluate)
+    {
+        const auto a = compute_acceleration(i, particles);
 
-        compare(reference_points, points);
+        auto k = st + 4 * (s + 1);
+        k[0] = particles.vx[i];
+        k[1] = particles.vy[i];
+        k[2] = a.x;
+        k[3] = a.y;
     }
-    else
+
+    Real y[4];
+
+    /* Stage sums in double, also for float points */
+    for (int c = 0; c < 4; c++)
     {
-        apply_method(points, interaction, method);
+        auto sum = 0.0;
+
+        for (int j = 0; j <= s; j++)
+        {
+            if (w[j] != 0.0)
+                sum += w[j] * st[4 * (j + 1) + c];
+        }
+
+        y[c] = (Real)(st[c] + h * sum);
     }
+
+    particles.x[i] = y[0];
+    particles.y[i] = y[1];
+    particles.vx[i] = y[2];
+    particles.vy[i] = y[3];
 }
 
-template<bool Compare>
-void euler(const double dt,
-           vector<Point>& points,
-           const vector<Spring>& springs,
-           const bool interaction)
+template<class Real, const auto& T, bool Compare>
+void runge_kutta(const double dt,
+                 BasicParticleSystem<Real>& particles,
+                 const vector<BasicSpring<Real>>& springs,
+                 const Adjacency& adjacency,
+                 const BasicSpringColoring<Real>& coloring,
+                 SimulationState& state,
+                 const bool interaction)
 {
-    apply_method<Compare>(dt, points, springs, interaction, 
-        [&](auto& point)
+    constexpr auto S = remove_reference_t<decltype(T)>::stages;
+    constexpr auto stride = rk_stride<T>;
+
+    apply_phases<Compare>(dt, particles, springs, adjacency, state, interaction, [&]()
     {
-        // x(t + h) = x(t) + h * v(t)
-        // v(t + h) = v(t) + h * a(t)
+        reserve_stages<Real>(state, stride, particles.Size());
 
-        const auto new_position = point.getPos() + point.getVel() * dt;
-        const auto a = compute_acceleration(point, springs);
+        const auto stage = state.GetStage<Real>().data();
 
-        point.setPos(new_position);
-        point.setVel(point.getVel() + a * dt);
+        for_each_stage(make_integer_sequence<int, S>(), [&](const auto s)
+        {
+            accumulate_spring_forces(particles, coloring);
+
+            for_each_free_point(particles, [&](const int i)
+            {
+                runge_kutta_point<T, decltype(s)::value>(i, dt, particles, stage + stride * i, true, true);
+            });
+        });
     });
 }
 
-template<bool Compare>
-void symplectic(const double dt,
-				vector<Point>& points,
-                const vector<Spring>& springs,
-				const bool interaction)
+/******************************************************************
+*
+* adaptive_runge_kutta
+*
+* Embedded Runge-Kutta pair with step control; the tableau must be
+* first same as last (a[S - 1] = b), so the last stage is evaluated
+* at the new state y' and is k_1 of the next step, unless the random
+* user force changes the external forces.
+*
+* The difference h sum_s e[s] k_s of the two solutions estimates the
+* local error, scaled by tolerance (1 + |y|) per component. Rejected
+* steps are retried with a smaller step; accepted ones propose the
+* next step length.
+*
+* The step is at most limit long; returns the accepted length.
+*
+*******************************************************************/
+
+/* Below this step length every step is accepted, so runs that blew up
+   still advance */
+static constexpr auto min_adaptive_step = 1e-10;
+
+template<class Real, const auto& T, bool Compare>
+double adaptive_runge_kutta(const double limit,
+                            BasicParticleSystem<Real>& particles,
+                            const vector<BasicSpring<Real>>& springs,
+                            const Adjacency& adjacency,
+                            const BasicSpringColoring<Real>& coloring,
+                            SimulationState& state,
+                            const bool interaction)
 {
-    apply_method<Compare>(dt, points, springs, interaction,
-        [&](auto& point)
+    constexpr auto S = remove_reference_t<decltype(T)>::stages;
+    constexpr auto stride = rk_stride<T>;
+    constexpr auto order = (double)T.errorOrder;
+
+    static_assert(T.errorOrder > 0, "Step control needs an embedded method");
+
+    auto& control = state.control;
+
+    auto taken = 0.0;
+
+    with_reference<Compare>(0.0, particles, springs, adjacency, state, interaction,
+        [&](const bool external)
     {
-        // x(t + h) = x(t) + h * v(t)
-        // v(t + h) = v(t) + h * a(t + h)
+        apply_external_forces(particles, state.rng, external);
+
+        const auto n = particles.Size();
+
+        if (reserve_stages<Real>(state, stride, n))
+            control.fsal = false;
+
+        const auto stage = state.GetStage<Real>().data();
+
+        // a new random user force invalidates the last stage of the last step
+        auto start = true;
+        auto evaluate = !control.fsal || external;
+
+        const auto preferred = control.step;
+        const auto tolerance = control.tolerance;
+
+        auto h = min(preferred, limit);
 
-        point.setPos(point.getPos() + point.getVel() * dt);
+        for (;;)
+        {
+            // all stages but the last end with particles = y'
+            for_each_stage(make_integer_sequence<int, S - 1>(), [&](const auto s)
+            {
+                if (decltype(s)::value > 0 || evaluate)
+                    accumulate_spring_forces(particles, coloring);
+
+                for_each_free_point(particles, [&](const int i)
+                {
+                    runge_kutta_point<T, decltype(s)::value>(i, h, particles, stage + stride * i, start, evaluate);
+                });
+            });
+
+            accumulate_spring_forces(particles, coloring);
+
+            // last stage at y' and weighted RMS of the local error estimate
+            const auto estimate = [&](const int begin, const int end, double& sum, int& count)
+            {
+                for (int i = begin; i < end; i++)
+                {
+                    if (particles.IsFixed(i))
+                        continue;
+
+                    const auto st = stage + stride * i;
+                    const auto a = compute_acceleration(i, particles);
+                    const Real y1[4] = { particles.x[i], particles.y[i], particles.vx[i], particles.vy[i] };
+
+                    auto k = st + 4 * S;
+                    k[0] = y1[2];
+                    k[1] = y1[3];
+                    k[2] = a.x;
+                    k[3] = a.y;
+
+                    for (int c = 0; c < 4; c++)
+                    {
+                        auto e = 0.0;
+
+                        for (int j = 0; j < S; j++)
+                        {
+                            if (T.e[j] != 0.0)
+                                e += T.e[j] * st[4 * (j + 1) + c];
+                        }
+
+                        const auto scale = tolerance * (1.0 + max(abs(st[c]), abs(y1[c])));
+
+                        sum += (h * e / scale) * (h * e / scale);
+                    }
+
+                    count += 4;
+                }
+            };
+
+            auto sum = 0.0;
+            auto count = 0;
+
+            if (n > parallel_points)
+            {
+                // partial sums per range, added in index order, so the
+                // step sequence does not depend on the number of threads
+                const auto ranges = (n + parallel_grain - 1) / parallel_grain;
 
-        const auto a = compute_acceleration(point, springs);
+                vector<double> sums(ranges, 0.0);
+                vector<int> counts(ranges, 0);
 
-        point.setVel(point.getVel() + a * dt);
+                ParallelRanges(n, [&](const int begin, const int end)
+                {
+                    estimate(begin, end, sums[begin / parallel_grain], counts[begin / parallel_grain]);
+                });
+
+                for (int r = 0; r < ranges; r++)
+                {
+                    sum += sums[r];
+                    count += counts[r];
+                }
+            }
+            else
+                estimate(0, n, sum, count);
+
+            const auto error = count > 0 ? sqrt(sum / count) : 0.0;
+
+            // PI control with the error of the last accepted step
+            // smooths the step sequence and avoids repeated rejections
+            const auto factor = error > 0.0 ?
+                min(5.0, max(0.2, 0.9 * pow(error, -0.7 / order) * pow(control.error, 0.4 / order))) : 5.0;
+
+            if (error <= 1.0 || h <= min_adaptive_step)
+            {
+                state.steps.accepted++;
+                state.time += h;
+                taken = h;
+
+                // a step shortened only by limit keeps the preferred length
+                control.step = (h == limit && limit < preferred) ?
+                    max(preferred, h * factor) : h * factor;
+
+                for_each_free_point(particles, [&](const int i)
+                {
+                    auto st = stage + stride * i;
+
+                    for (int c = 0; c < 4; c++)
+                        st[4 + c] = st[4 * S + c];
+                });
+
+                control.error = max(error, 1e-4);
+                control.fsal = true;
+                break;
+            }
+
+            // retry from y0 with k_1 kept; NaN errors shrink the step
+            // as far as possible
+            state.steps.rejected++;
+            h = max(min_adaptive_step, h * (error == error ? factor : 0.2));
+
+            start = false;
+            evaluate = false;
+        }
     });
+
+    return taken;
 }
 
-template<bool Compare>
-void midpoint(const double dt, 
-			  vector<Point>& points, 
-              const vector<Spring>& springs,
-	          const bool interaction)
+/******************************************************************
+*
+* Step policies
+*
+* Every method is a scheme with the same signature; fixed_step and
+* variable_step wrap it into a StepFunction that also keeps time,
+* step counts and the trajectory record. GetStepFunction picks the
+* instantiation once per scene (Scene::Init), so a step is a single
+* indirect call into code compiled for that method, stepping order
+* and reference comparison.
+*
+*******************************************************************/
+
+template<class Real>
+static void record_step(const BasicParticleSystem<Real>& particles, SimulationState& state)
 {
-    apply_method<Compare>(dt, points, springs, interaction,
-        [&](auto& point)
+    /* Scenes without reference record NaN as error, the others only
+       steps compared with it */
+    if (state.recorder && (!state.analytical || state.sampling.sampled))
     {
-        const auto a = compute_acceleration(point, springs);
+        ScopedPhaseTimer timer(PHASE_RECORD);
+        state.recorder->Record(state.time, state.analytical ? state.error.last : NAN, particles);
+    }
+}
 
-        const auto original_velocity = point.getVel();
+/* Collision stage; moved points invalidate the last stage kept by
+   first same as last methods */
+template<class Real>
+static void resolve_contacts(BasicParticleSystem<Real>& particles, SimulationState& state)
+{
+    if (!state.contacts.enabled)
+        return;
 
-        point.setVel(point.getVel() + dt / 2.0 * a);
+    ScopedPhaseTimer timer(PHASE_CONTACTS);
 
-        const auto original_position = point.getPos();
+    if (state.contacts.Resolve(particles) > 0)
+        state.control.fsal = false;
+}
 
-        point.setPos(point.getPos() + dt / 2.0 * point.getVel());
+template<class Real, auto Scheme>
+double fixed_step(const double dt, BasicParticleSystem<Real>& particles, vector<BasicSpring<Real>>& springs,
+                  const Adjacency& adjacency, const BasicSpringColoring<Real>& coloring,
+                  SimulationState& state, const bool interaction)
+{
+    state.time += dt;
+    state.steps.accepted++;
 
-        const auto a_new = compute_acceleration(point, springs);
+    Scheme(dt, particles, springs, adjacency, coloring, state, interaction);
 
-        point.setPos(original_position + dt * point.getVel());
+    resolve_contacts(particles, state);
 
-        point.setVel(original_velocity + dt * a_new);
-    });
+    record_step(particles, state);
+
+    return dt;
 }
 
-template<bool Compare>
-void leapfrog(const double dt, 
-			  vector<Point>& points, 
-			  vector<Spring>& springs, 
-	          const bool interaction)
+template<class Real, auto Scheme>
+double variable_step(const double limit, BasicParticleSystem<Real>& particles, vector<BasicSpring<Real>>& springs,
+                     const Adjacency& adjacency, const BasicSpringColoring<Real>& coloring,
+                     SimulationState& state, const bool interaction)
 {
-    apply_method<Compare>(dt, points, springs, interaction,
-        [&](auto& point)
-    {
-        const auto a = compute_acceleration(point, springs);
+    const auto taken = Scheme(limit, particles, springs, adjacency, coloring, state, interaction);
 
-        const auto old_velocity = point.getVel() - dt / 2.0 * a;
+    resolve_contacts(particles, state);
 
-        const auto new_velocity = old_velocity + dt * a;
+    record_step(particles, state);
 
-        point.setPos(point.getPos() + dt  * new_velocity);
+    return taken;
+}
 
-        point.setVel(new_velocity);
-    });
+/* Generated scenes skip the reference and keep the user force */
+template<class Real, auto Compared, auto Plain>
+BasicStepFunction<Real> fixed(const bool analytical)
+{
+    return analytical ? fixed_step<Real, Compared> : fixed_step<Real, Plain>;
+}
+
+template<class Real, auto Compared, auto Plain>
+BasicStepFunction<Real> variable(const bool analytical)
+{
+    return analytical ? variable_step<Real, Compared> : variable_step<Real, Plain>;
 }
 
 /******************************************************************
 *
-* TimeStep
+* GetStepFunction
+*
+* Returns the function called every time step of the dynamic
+* simulation. Positions, velocities, etc. are updated to simulate
+* motion of the mass points of the 2D scene. The adjacency index maps
+* every point to its incident springs, so one step costs
+* O(points + springs).
 *
-* This function is called every time step of the dynamic simulation.
-* Positions, velocities, etc. should be updated to simulate motion
-* of the mass points of the 2D scene. The selected solver is passed
-* to the function as well as the time step, the springs, and the
-* mass points.
+* With INPLACE stepping the explicit schemes update point after point,
+* so later points see already updated neighbors (the original
+* behavior); their update order is part of the result, so they run
+* on one thread. TWOPHASE evaluates all forces from one state and
+* then updates all points in parallel. The Runge-Kutta methods, the
+* implicit and the Verlet scheme and XPBD ignore the stepping and
+* always run their passes in parallel.
+*
+* Adaptive methods treat dt as the longest allowed step; the length
+* of the step actually taken is returned.
 *
 *******************************************************************/
 
-void TimeStep(const double dt, const Scene::Method method,
-               vector<Point>& points, vector<Spring>& springs, const bool interaction)
+template<class Real>
+BasicStepFunction<Real> GetStepFunction(const Scene::Method method, const Scene::Stepping stepping,
+                                        const bool analytical)
 {
-    update_time(dt);
+    const auto twophase = stepping == Scene::TWOPHASE;
 
-	switch (method)
-	{
-		case Scene::EULER:
-		{
-			return euler<true>(dt, points, springs, interaction);
-		}
+    switch (method)
+    {
+        case Scene::EULER:
+            return twophase ?
+                fixed<Real, euler_phases<Real, true>, euler_phases<Real, false>>(analytical) :
+                fixed<Real, euler<Real, true>, euler<Real, false>>(analytical);
 
-		case Scene::SYMPLECTIC:
-		{
-			return symplectic<true>(dt, points, springs, interaction);
-		}
+        case Scene::SYMPLECTIC:
+            return twophase ?
+                fixed<Real, symplectic_phases<Real, true>, symplectic_phases<Real, false>>(analytical) :
+                fixed<Real, symplectic<Real, true>, symplectic<Real, false>>(analytical);
 
-		case Scene::LEAPFROG:
-		{
-            return leapfrog<true>(dt, points, springs, interaction);
-		}
+        case Scene::LEAPFROG:
+            return twophase ?
+                fixed<Real, leapfrog_phases<Real, true>, leapfrog_phases<Real, false>>(analytical) :
+                fixed<Real, leapfrog<Real, true>, leapfrog<Real, false>>(analytical);
 
-		case Scene::MIDPOINT:
-		{
-			return midpoint<true>(dt, points, springs, interaction);
-		}
-	}
+        case Scene::MIDPOINT:
+            return twophase ?
+                fixed<Real, midpoint_phases<Real, true>, midpoint_phases<Real, false>>(analytical) :
+                fixed<Real, midpoint<Real, true>, midpoint<Real, false>>(analytical);
+
+        case Scene::IMPLICIT_EULER:
+            return fixed<Real, implicit_euler<Real, true>, implicit_euler<Real, false>>(analytical);
+
+        case Scene::VELOCITY_VERLET:
+            return fixed<Real, velocity_verlet<Real, true>, velocity_verlet<Real, false>>(analytical);
+
+        case Scene::ADAPTIVE:
+            return variable<Real, adaptive_runge_kutta<Real, bs23_tableau, true>,
+                            adaptive_runge_kutta<Real, bs23_tableau, false>>(analytical);
+
+        case Scene::RK2:
+            return fixed<Real, runge_kutta<Real, rk2_tableau, true>, runge_kutta<Real, rk2_tableau, false>>(analytical);
+
+        case Scene::RK4:
+            return fixed<Real, runge_kutta<Real, rk4_tableau, true>, runge_kutta<Real, rk4_tableau, false>>(analytical);
+
+        case Scene::RK45:
+            return variable<Real, adaptive_runge_kutta<Real, dopri5_tableau, true>,
+                            adaptive_runge_kutta<Real, dopri5_tableau, false>>(analytical);
+
+        case Scene::XPBD:
+            return fixed<Real, xpbd<Real, true>, xpbd<Real, false>>(analytical);
+    }
+
+    return nullptr;
 }
+
+template StepFunction GetStepFunction<double>(Scene::Method, Scene::Stepping, bool);
+template StepFunctionF32 GetStepFunction<float>(Scene::Method, Scene::Stepping, bool);
@@ -0,0 +1,253 @@
+/******************************************************************
+*
+* ImplicitEuler.cpp
+*
+* Description: Assembly and preconditioned conjugate gradient solve
+* of the linearized backward Euler system
+*
+* CG following Jonathan Richard Shewchuk, "An Introduction to the
+* Conjugate Gradient Method Without the Agonizing Pain"; fixed points
+* are filtered out of residual and search direction, as in Baraff and
+* Witkin, "Large Steps in Cloth Simulation"
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <cmath>
+#include <algorithm>
+
+#include "ImplicitEuler.h"
+#include "TaskPool.h"
+
+/* Partial sums per range, added in index order, so the iterates do
+   not depend on the number of threads */
+static double dot(const vector<double>& ax, const vector<double>& ay,
+                  const vector<double>& bx, const vector<double>& by,
+                  vector<double>& sums)
+{
+	const auto n = (int)ax.size();
+
+	const auto sum = [&](const int begin, const int end)
+	{
+		auto v = 0.0;
+
+		for (int i = begin; i < end; i++)
+			v += ax[i] * bx[i] + ay[i] * by[i];
+
+		return v;
+	};
+
+	if (n <= parallel_points)
+		return sum(0, n);
+
+	sums.resize((n + parallel_grain - 1) / parallel_grain);
+
+	ParallelRanges(n, [&](const int begin, const int end)
+	{
+		sums[begin / parallel_grain] = sum(begin, end);
+	});
+
+	auto v = 0.0;
+
+	for (auto partial : sums)
+		v += partial;
+
+	return v;
+}
+
+template<class Real>
+void ImplicitSolver::Multiply(const double h2, const BasicParticleSystem<Real>& particles,
+                              const Adjacency& adjacency,
+                              const vector<double>& inx, const vector<double>& iny,
+                              vector<double>& outx, vector<double>& outy) const
+{
+	const auto n = particles.Size();
+
+	/* Row i: A_ii in_i + sum over incident springs of h^2 K_s in_j */
+	ParallelForEach(n, [&](const int i)
+	{
+		if (particles.IsFixed(i))
+		{
+			outx[i] = 0.0;
+			outy[i] = 0.0;
+			return;
+		}
+
+		const auto& a = diag[i];
+
+		auto sx = a.xx * inx[i] + a.xy * iny[i];
+		auto sy = a.xy * inx[i] + a.yy * iny[i];
+
+		for (auto it = adjacency.begin(i); it != adjacency.end(i); ++it)
+		{
+			const auto& k = springK[it->spring];
+			const auto j = it->other;
+
+			sx += h2 * (k.xx * inx[j] + k.xy * iny[j]);
+			sy += h2 * (k.xy * inx[j] + k.yy * iny[j]);
+		}
+
+		outx[i] = sx;
+		outy[i] = sy;
+	});
+}
+
+template<class Real>
+void ImplicitSolver::Solve(const double h, const BasicParticleSystem<Real>& particles,
+                           const vector<BasicSpring<Real>>& springs, const Adjacency& adjacency)
+{
+	const auto n = particles.Size();
+	const auto numSprings = (int)springs.size();
+	const auto h2 = h * h;
+
+	springK.resize(numSprings);
+	diag.resize(n);
+	precond.resize(n);
+
+	for (auto v : { &dvx, &dvy, &bx, &by, &rx, &ry, &zx, &zy, &px, &py, &qx, &qy })
+		v->resize(n);
+
+	/* Linearize every spring force around the current positions:
+	   K = -k (u u^T + c (I - u u^T)), c = max(0, 1 - L / |d|);
+	   clamping c keeps K negative semi-definite under compression,
+	   so the system matrix stays positive definite */
+	ParallelForEach(numSprings, [&](const int s)
+	{
+		const auto& spring = springs[s];
+		const auto i0 = spring.getPoint(0);
+		const auto i1 = spring.getPoint(1);
+
+		const auto dx = (double)particles.x[i0] - particles.x[i1];
+		const auto dy = (double)particles.y[i0] - particles.y[i1];
+		const auto length = sqrt(dx * dx + dy * dy);
+		const auto k = (double)spring.getStiffness();
+
+		if (length < 0.00000001)
+		{
+			springK[s] = Block{ -k, 0.0, -k };
+			return;
+		}
+
+		const auto ux = dx / length;
+		const auto uy = dy / length;
+		const auto c = max(0.0, 1.0 - spring.getRestLength() / length);
+
+		springK[s] = Block{
+			-k * ((1.0 - c) * ux * ux + c),
+			-k * ((1.0 - c) * ux * uy),
+			-k * ((1.0 - c) * uy * uy + c) };
+	});
+
+	/* Diagonal blocks, preconditioner and right-hand side
+	   b = h (f - d v + h K v) */
+	ParallelForEach(n, [&](const int i)
+	{
+		dvx[i] = 0.0;
+		dvy[i] = 0.0;
+
+		if (particles.IsFixed(i))
+		{
+			diag[i] = Block{ 1.0, 0.0, 1.0 };
+			precond[i] = Block{ 1.0, 0.0, 1.0 };
+			bx[i] = 0.0;
+			by[i] = 0.0;
+			return;
+		}
+
+		const auto d = (double)particles.damping[i];
+		const auto md = 1.0 / particles.invMass[i] + h * d;
+
+		auto a = Block{ md, 0.0, md };
+		auto kvx = 0.0;
+		auto kvy = 0.0;
+
+		for (auto it = adjacency.begin(i); it != adjacency.end(i); ++it)
+		{
+			const auto& k = springK[it->spring];
+			const auto j = it->other;
+
+			a.xx -= h2 * k.xx;
+			a.xy -= h2 * k.xy;
+			a.yy -= h2 * k.yy;
+
+			const auto rvx = (double)particles.vx[i] - particles.vx[j];
+			const auto rvy = (double)particles.vy[i] - particles.vy[j];
+
+			kvx += k.xx * rvx + k.xy * rvy;
+			kvy += k.xy * rvx + k.yy * rvy;
+		}
+
+		diag[i] = a;
+
+		const auto det = a.xx * a.yy - a.xy * a.xy;
+		precond[i] = Block{ a.yy / det, -a.xy / det, a.xx / det };
+
+		bx[i] = h * (particles.fx[i] - d * particles.vx[i] + h * kvx);
+		by[i] = h * (particles.fy[i] - d * particles.vy[i] + h * kvy);
+	});
+
+	/* Preconditioned conjugate gradient, starting from dv = 0 */
+	auto precondition = [&]()
+	{
+		ParallelForEach(n, [&](const int i)
+		{
+			const auto& p = precond[i];
+			zx[i] = p.xx * rx[i] + p.xy * ry[i];
+			zy[i] = p.xy * rx[i] + p.yy * ry[i];
+		});
+	};
+
+	rx = bx;
+	ry = by;
+
+	precondition();
+
+	px = zx;
+	py = zy;
+
+	auto deltaNew = dot(rx, ry, zx, zy, sums);
+	const auto delta0 = deltaNew;
+
+	iterations = 0;
+
+	while (iterations < maxIterations &&
+	       deltaNew > tolerance * tolerance * delta0)
+	{
+		Multiply(h2, particles, adjacency, px, py, qx, qy);
+
+		const auto alpha = deltaNew / dot(px, py, qx, qy, sums);
+
+		ParallelForEach(n, [&](const int i)
+		{
+			dvx[i] += alpha * px[i];
+			dvy[i] += alpha * py[i];
+			rx[i] -= alpha * qx[i];
+			ry[i] -= alpha * qy[i];
+		});
+
+		precondition();
+
+		const auto deltaOld = deltaNew;
+		deltaNew = dot(rx, ry, zx, zy, sums);
+
+		const auto beta = deltaNew / deltaOld;
+
+		ParallelForEach(n, [&](const int i)
+		{
+			px[i] = zx[i] + beta * px[i];
+			py[i] = zy[i] + beta * py[i];
+		});
+
+		iterations++;
+	}
+}
+
+template void ImplicitSolver::Solve(double, const ParticleSystem&,
+                                    const vector<Spring>&, const Adjacency&);
+template void ImplicitSolver::Solve(double, const ParticleSystemF32&,
+                                    const vector<SpringF32>&, const Adjacency&);
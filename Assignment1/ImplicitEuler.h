@@ -0,0 +1,77 @@
+/******************************************************************
+*
+* ImplicitEuler.h
+*
+* Description: Linearized backward Euler step for the mass-spring
+* system; the spring forces are linearized around the current state,
+* the sparse system (M - h D - h^2 K) dv = h (f + h K v) is solved
+* for the velocity change with a block-Jacobi preconditioned
+* conjugate gradient
+*
+* The sparsity pattern of the system matrix is the adjacency of the
+* spring graph: row i holds the diagonal block of point i and one
+* off-diagonal block per incident spring
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __IMPLICIT_EULER_H__
+#define __IMPLICIT_EULER_H__
+
+#include <vector>
+using namespace std;
+
+#include "ParticleSystem.h"
+#include "Spring.h"
+#include "Adjacency.h"
+
+class ImplicitSolver
+{
+public:
+	double tolerance = 1e-8; /* Relative residual of the CG solve */
+	int maxIterations = 1000;
+
+	/* Compute the velocity change of one backward Euler step of size
+	   h; forces in particles.fx/fy must match the current state. The
+	   system is assembled and solved in double for either point type */
+	template<class Real>
+	void Solve(double h, const BasicParticleSystem<Real>& particles,
+	           const vector<BasicSpring<Real>>& springs, const Adjacency& adjacency);
+
+	vector<double> dvx, dvy; /* Velocity change per point */
+
+	int GetIterations() const
+	{
+		return iterations;
+	}
+
+private:
+	/* Symmetric 2x2 block */
+	struct Block
+	{
+		double xx, xy, yy;
+	};
+
+	vector<Block> springK;  /* Force Jacobian d f_0 / d x_0 per spring */
+	vector<Block> diag;     /* Diagonal blocks of the system matrix */
+	vector<Block> precond;  /* Inverted diagonal blocks */
+
+	/* CG work vectors */
+	vector<double> bx, by, rx, ry, zx, zy, px, py, qx, qy;
+	vector<double> sums;    /* Partial sums of dot products */
+
+	int iterations = 0;
+
+	template<class Real>
+	void Multiply(double h2, const BasicParticleSystem<Real>& particles,
+	              const Adjacency& adjacency,
+	              const vector<double>& inx, const vector<double>& iny,
+	              vector<double>& outx, vector<double>& outy) const;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/******************************************************************
+*
+* MappedFile.cpp
+*
+* Description: Platform specific implementation of the read-only
+* file mapping
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+	                   OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER length;
+
+	if (!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!mapping)
+	{
+		Close();
+		return false;
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	size = (size_t)length.QuadPart;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		UnmapViewOfFile(data);
+
+	if (mapping)
+		CloseHandle(mapping);
+
+	if (file)
+		CloseHandle(file);
+
+	data = nullptr;
+	size = 0;
+	mapping = nullptr;
+	file = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	const auto fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	auto address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	/* The mapping keeps its own reference to the file */
+	close(fd);
+
+	if (address == MAP_FAILED)
+		return false;
+
+	/* Arrays are read front to back exactly once */
+	madvise(address, (size_t)info.st_size, MADV_SEQUENTIAL);
+	madvise(address, (size_t)info.st_size, MADV_WILLNEED);
+
+	data = static_cast<const char*>(address);
+	size = (size_t)info.st_size;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		munmap(const_cast<char*>(data), size);
+
+	data = nullptr;
+	size = 0;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/******************************************************************
+*
+* MappedFile.h
+*
+* Description: Read-only memory mapping of a whole file (mmap on
+* POSIX systems, file mapping objects on Windows); the contents are
+* paged in by the operating system on first access
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <cstddef>
+
+class MappedFile
+{
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* file = nullptr;    /* HANDLE of the file */
+	void* mapping = nullptr; /* HANDLE of the mapping object */
+#endif
+
+public:
+	MappedFile() {}
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const char* path); /* False, if file cannot be mapped */
+	void Close();
+
+	const char* Data() const
+	{
+		return data;
+	}
+
+	size_t Size() const
+	{
+		return size;
+	}
+};
+
+#endif
@@ -3,10 +3,16 @@
 * MassSpring.cpp  
 *
 * Description: This file initializes the framework, sets up the
-* rendering (using legacy OpenGL), and calls the scene update;
-* it is possible to select a fixed amount of time steps per display
-* frame (likely not running in real-time) or to attempt execution
-* in real-time (requires setting of variable "steps_per_frame"
+* rendering (using legacy OpenGL), and starts the simulation thread;
+* it is possible to select a fixed amount of time steps per snapshot
+* (likely not running in real-time) or to attempt execution in
+* real-time (requires setting of variable "steps_per_slice")
+*
+* Besides the scene options, -timings [csv file] writes the phase
+* timer statistics when the application ends; 'o' shows them live
+*
+* 'k' writes a checkpoint of the running simulation (-checkpoint,
+* ./lastrun.ckpt by default) and 'l' continues from it
 *
 * Physically-Based Simulation Proseminar WS 2015
 * 
@@ -19,9 +25,11 @@
 /* Standard includes */
 #include <GL/freeglut.h>
 #include "Scene.h"
+#include "SimulationThread.h"
+#include "SceneRenderer.h"
+#include "PhaseTimers.h"
 
-#include <chrono>
-#include <ctime>
+#include <cstring>
 #include <iostream>
 
 /*----------------------------------------------------------------*/
@@ -29,54 +37,30 @@
 /* Simulation scene */
 Scene* scene = NULL;
 
-/* Time steps to be calculated per displayed output frame 
-  (set to 0 to run simulation in real-time) */
-static int steps_per_frame = 0;
-
-/* Maximum time allowed between updates when running in real-time 
-   mode (prevents performing too many calculations when running 
-   slower than real time) */
-static double max_update_time = 0.01;
+/* Thread running the time steps of the scene */
+SimulationThread* simulation = NULL;
 
-/* Variables to keep track of timing information */
-static unsigned long prevTime = 0;
-static double remTime = 0;
+/* Draws the snapshots of the simulation thread */
+static SceneRenderer renderer;
 
+/* Time steps to be calculated per published snapshot, as fast as
+  possible (set to 0 to run simulation in real-time) */
+static int steps_per_slice = 0;
 
-/******************************************************************
-*
-* GetTime
-*
-* Returns curring time in milliseconds.
-*
-*******************************************************************/
-
-unsigned long GetTime()
-{
-	/*struct timeval tv;
-	gettimeofday(&tv, NULL);
-	return (unsigned long)(tv.tv_sec * 1000 + tv.tv_usec);*/
+/* Show the phase timer overlay */
+static bool show_phases = false;
 
-	using chrono::duration_cast;
-	using chrono::milliseconds;
-	using chrono::system_clock;
+/* Phase timer statistics written on exit, if set */
+static const char* timings_file = NULL;
 
-	return static_cast<unsigned long>(duration_cast<milliseconds>(
-			system_clock::now().time_since_epoch())
-		.count());
-}
 
 /******************************************************************
 *
 * Display
 *
-* Update scene (thus executing simulation time step); either run a
-* fixed amount of steps per visual frame (i.e. possibly running
-* faster or slower than actual time) or attempt to execute as many
-* steps as actual time window (i.e. execution in real-time);
-*
-* Note: the time to simulate a second in the physical simulation 
-* may be smaller or larger than a second
+* Draw the latest snapshot of the simulation thread; the steps run
+* on that thread, so the simulation speed does not depend on the
+* frame rate (see SimulationThread.h)
 *
 *******************************************************************/
 
@@ -84,36 +68,39 @@ void Display(void)
 {
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	if (steps_per_frame > 0)
 	{
-		/* Fixed number of time steps per display frame */
-		for (int i = 0; i < steps_per_frame; ++i)
-			scene->Update();
+		ScopedPhaseTimer timer(PHASE_RENDER);
+		renderer.Render(simulation->GetSnapshot());
 	}
-	else
-	{
-		/* Attempt to run simulation in real-time */
-		unsigned long curTime = GetTime();
-		double timePassed = (curTime - prevTime) / 1000.0;
-		if (timePassed > max_update_time)
-			timePassed = max_update_time;
 
-		timePassed += remTime;
+	if (show_phases)
+		renderer.RenderPhases();
 
-		int steps = (int)(timePassed / scene->GetStep());
+	glutPostRedisplay();
 
-		for (int i = 0; i < steps; i++)
-			scene->Update();
+	ScopedPhaseTimer timer(PHASE_SWAP);
+	glutSwapBuffers();
+}
 
-		prevTime = curTime;
-		remTime = fmod(timePassed, scene->GetStep());
-	}
+/******************************************************************
+*
+* Shutdown
+*
+* Stop the simulation, write the phase times if requested and free
+* the scene; its destructor writes the remaining trajectory records
+*
+*******************************************************************/
 
-	/* Scene is rendered after simulation time step(s) */
-	scene->Render();
+void Shutdown(void)
+{
+	delete simulation;
+	simulation = NULL;
 
-	glutPostRedisplay();
-	glutSwapBuffers();
+	if (timings_file)
+		SavePhaseTimes(timings_file);
+
+	delete scene;
+	scene = NULL;
 }
 
 /******************************************************************
@@ -167,8 +154,7 @@ void Init(void)
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 
-	/* Store start time */
-	prevTime = GetTime();
+	renderer.Init();
 }
 
 /******************************************************************
@@ -183,31 +169,66 @@ void Init(void)
 
 void Keyboard(unsigned char key, int x, int y)
 {
+	/* Scene changes are applied by the simulation thread between steps */
+	auto post = [](const SceneCommand::Type type, const double value)
+	{
+		if (!simulation->Post(SceneCommand{ type, value }))
+			cerr << "Too many pending commands, key ignored" << endl;
+	};
+
 	switch (key)
 	{
 		case 'q': case 'Q':
+			Shutdown();
 			exit(0);
 			break;
 
 		case 'f':
 			/* Toggle (hard-coded) external force on a mass point */
-			scene->ToggleUserForce();
+			post(SceneCommand::TOGGLE_FORCE, 0.0);
+			break;
+
+		case 'c':
+			/* Toggle collisions between points and with the ground */
+			post(SceneCommand::TOGGLE_CONTACTS, 0.0);
+			break;
+
+		case 'o':
+			/* Toggle the overlay of the phase timers */
+			show_phases = !show_phases;
+			break;
+
+		case 'v':
+			/* Toggle batched and per-object drawing */
+			renderer.ToggleMode();
+			cout << (renderer.GetMode() == SceneRenderer::BATCHED ? "Batched" : "Immediate")
+			     << " rendering" << endl;
 			break;
         //Add user input for changing scene parameter
 		case 'm':
-			scene->increaseMass(0.01);
+			post(SceneCommand::MASS, 0.01);
 			break;
 		case 's':
-			scene->increaseStiff(10.0);
+			post(SceneCommand::STIFFNESS, 10.0);
 			break;
 		case 'd':
-			scene->increaseDamp(0.01);
+			post(SceneCommand::DAMPING, 0.01);
 			break;
 		case 't':
-			scene->increaseStep(0.001);
+			post(SceneCommand::STEP, 0.001);
 			break;
 		case 'r':
-			scene->resetInitial();
+			post(SceneCommand::RESET, 0.0);
+			break;
+
+		case 'k':
+			/* Save the complete state, written in the background */
+			post(SceneCommand::CHECKPOINT, 0.0);
+			break;
+
+		case 'l':
+			/* Continue from the last checkpoint */
+			post(SceneCommand::RESTORE, 0.0);
 			break;
 
 	}
@@ -231,14 +252,38 @@ int main(int argc, char** argv)
 	glutInitWindowSize(600, 600);
 	glutCreateWindow("Mass-Spring Example");
 
+	/* Options of the application are removed, the rest is the scene's */
+	int kept = 1;
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (!strcmp(argv[arg], "-timings") && arg + 1 < argc)
+			timings_file = argv[++arg];
+		else
+			argv[kept++] = argv[arg];
+	}
+
+	argc = kept;
+
+	EnablePhaseTimers(true);
+
 	scene = new Scene(argc, argv);
+	simulation = new SimulationThread(*scene, steps_per_slice);
 	Init();
 	glutDisplayFunc(Display);
 	glutReshapeFunc(Reshape);
 	glutKeyboardFunc(Keyboard);
 	glutIdleFunc(Idle);
 
+	/* Return from the main loop when the window is closed, so the
+	   scene can finish its trajectory */
+	glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+
+	simulation->Start();
+
 	glutMainLoop();
 
+	Shutdown();
+
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,73 @@
+/******************************************************************
+*
+* ParticleSystem.cpp
+*
+* Description: Implementation of functions for handling the mass
+* point arrays
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include "ParticleSystem.h"
+
+template<class Real>
+void BasicParticleSystem<Real>::Clear()
+{
+	x.clear();
+	y.clear();
+	vx.clear();
+	vy.clear();
+	fx.clear();
+	fy.clear();
+	ux.clear();
+	uy.clear();
+	invMass.clear();
+	damping.clear();
+	fixedMask.clear();
+}
+
+template<class Real>
+void BasicParticleSystem<Real>::Reserve(const int n)
+{
+	x.reserve(n);
+	y.reserve(n);
+	vx.reserve(n);
+	vy.reserve(n);
+	fx.reserve(n);
+	fy.reserve(n);
+	ux.reserve(n);
+	uy.reserve(n);
+	invMass.reserve(n);
+	damping.reserve(n);
+	fixedMask.reserve((n + 63) / 64);
+}
+
+template<class Real>
+int BasicParticleSystem<Real>::Add(const Vec2 p, const double m, const double d)
+{
+	const auto i = Size();
+
+	x.push_back((Real)p.x);
+	y.push_back((Real)p.y);
+	vx.push_back(0.0);
+	vy.push_back(0.0);
+	fx.push_back(0.0);
+	fy.push_back(0.0);
+	ux.push_back(0.0);
+	uy.push_back(0.0);
+	invMass.push_back((Real)(1.0 / m));
+	damping.push_back((Real)d);
+
+	if ((i & 63) == 0)
+		fixedMask.push_back(0);
+
+	return i;
+}
+
+template class BasicParticleSystem<double>;
+template class BasicParticleSystem<float>;
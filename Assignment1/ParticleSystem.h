@@ -0,0 +1,155 @@
+/******************************************************************
+*
+* ParticleSystem.h
+*
+* Description: Structure-of-arrays storage for all mass points of a
+* scene; every attribute lives in its own contiguous array so that
+* integrator loops only stream the data they actually use
+*
+* The scalar type of the arrays is a template parameter; scenes keep
+* their points in double and step a float copy with -precision float
+* (see Scene.h).
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __PARTICLE_SYSTEM_H__
+#define __PARTICLE_SYSTEM_H__
+
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+#include "Vec2.h"
+
+template<class Real>
+class BasicParticleSystem
+{
+public:
+	vector<Real> x, y;      /* Positions of mass points */
+	vector<Real> vx, vy;    /* Velocities of mass points */
+	vector<Real> fx, fy;    /* Sum of all forces on mass points */
+	vector<Real> ux, uy;    /* Additional external force exerted by user */
+	vector<Real> invMass;   /* Reciprocal mass */
+	vector<Real> damping;
+
+	vector<uint64_t> fixedMask; /* Bit i set, if point i is fixed in space */
+
+public:
+	int Size() const
+	{
+		return (int)x.size();
+	}
+
+	void Clear();
+	void Reserve(int n);
+
+	/* Append a resting point and return its index */
+	int Add(Vec2 p, double m, double d);
+
+	/* Copy of all points in another scalar type */
+	template<class Other>
+	void Assign(const BasicParticleSystem<Other>& other)
+	{
+		Convert(x, other.x);
+		Convert(y, other.y);
+		Convert(vx, other.vx);
+		Convert(vy, other.vy);
+		Convert(fx, other.fx);
+		Convert(fy, other.fy);
+		Convert(ux, other.ux);
+		Convert(uy, other.uy);
+		Convert(invMass, other.invMass);
+		Convert(damping, other.damping);
+		fixedMask = other.fixedMask;
+	}
+
+	/* Convenience accessors for code outside the hot loops */
+	BasicVec2<Real> GetPos(int i) const
+	{
+		return BasicVec2<Real>(x[i], y[i]);
+	}
+
+	void SetPos(int i, BasicVec2<Real> p)
+	{
+		x[i] = p.x;
+		y[i] = p.y;
+	}
+
+	BasicVec2<Real> GetVel(int i) const
+	{
+		return BasicVec2<Real>(vx[i], vy[i]);
+	}
+
+	void SetVel(int i, BasicVec2<Real> v)
+	{
+		vx[i] = v.x;
+		vy[i] = v.y;
+	}
+
+	BasicVec2<Real> GetForce(int i) const
+	{
+		return BasicVec2<Real>(fx[i], fy[i]);
+	}
+
+	void SetForce(int i, BasicVec2<Real> f)
+	{
+		fx[i] = f.x;
+		fy[i] = f.y;
+	}
+
+	BasicVec2<Real> GetUserForce(int i) const
+	{
+		return BasicVec2<Real>(ux[i], uy[i]);
+	}
+
+	void SetUserForce(int i, BasicVec2<Real> f)
+	{
+		ux[i] = f.x;
+		uy[i] = f.y;
+	}
+
+	Real GetMass(int i) const
+	{
+		return 1 / invMass[i];
+	}
+
+	bool IsFixed(int i) const
+	{
+		return (fixedMask[i >> 6] >> (i & 63)) & 1u;
+	}
+
+	void SetFixed(int i, bool fix)
+	{
+		const auto bit = uint64_t(1) << (i & 63);
+
+		if (fix)
+			fixedMask[i >> 6] |= bit;
+		else
+			fixedMask[i >> 6] &= ~bit;
+	}
+
+private:
+	/* Element-wise, rounding to nearest when narrowing */
+	template<class Other>
+	static void Convert(vector<Real>& to, const vector<Other>& from)
+	{
+		to.resize(from.size());
+
+		for (size_t i = 0; i < from.size(); i++)
+			to[i] = (Real)from[i];
+	}
+};
+
+extern template class BasicParticleSystem<double>;
+extern template class BasicParticleSystem<float>;
+
+typedef BasicParticleSystem<double> ParticleSystem;
+typedef BasicParticleSystem<float> ParticleSystemF32;
+
+#endif
@@ -0,0 +1,119 @@
+/******************************************************************
+*
+* PhaseTimers.cpp
+*
+* Description: Sample windows and statistics of the phase timers,
+* see PhaseTimers.h
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "PhaseTimers.h"
+
+atomic<bool> phase_timers_enabled(false);
+
+struct PhaseSamples
+{
+	atomic<uint32_t> window[phase_window]; /* Nanoseconds, ring */
+	atomic<uint64_t> count;
+	atomic<uint64_t> total;                /* Nanoseconds */
+};
+
+/* Zero-initialized as a static */
+static PhaseSamples phases[NUM_PHASES];
+
+const char* GetPhaseName(const Phase phase)
+{
+	switch (phase)
+	{
+		case PHASE_STEP: return "step";
+		case PHASE_FORCES: return "forces";
+		case PHASE_INTEGRATE: return "integrate";
+		case PHASE_REFERENCE: return "reference";
+		case PHASE_CONTACTS: return "contacts";
+		case PHASE_RECORD: return "record";
+		case PHASE_SNAPSHOT: return "snapshot";
+		case PHASE_RENDER: return "render";
+		case PHASE_SWAP: return "swap";
+		default: return "?";
+	}
+}
+
+void EnablePhaseTimers(const bool enable)
+{
+	phase_timers_enabled = enable;
+}
+
+void AddPhaseSample(const Phase phase, const uint64_t nanoseconds)
+{
+	auto& samples = phases[phase];
+
+	const auto k = samples.count.fetch_add(1, memory_order_relaxed);
+
+	samples.window[k % phase_window].store((uint32_t)min<uint64_t>(nanoseconds, UINT32_MAX),
+	                                       memory_order_relaxed);
+	samples.total.fetch_add(nanoseconds, memory_order_relaxed);
+}
+
+PhaseSummary SummarizePhase(const Phase phase)
+{
+	const auto& samples = phases[phase];
+
+	PhaseSummary summary = {};
+
+	summary.count = (long)samples.count.load(memory_order_relaxed);
+	summary.total = samples.total.load(memory_order_relaxed) * 1e-9;
+
+	const auto n = (int)min<long>(summary.count, phase_window);
+
+	if (n == 0)
+		return summary;
+
+	/* Slots may be overwritten while copying; the window is a
+	   sample of recent steps either way */
+	vector<uint32_t> sorted(n);
+
+	for (int k = 0; k < n; k++)
+		sorted[k] = samples.window[k].load(memory_order_relaxed);
+
+	sort(sorted.begin(), sorted.end());
+
+	summary.min = sorted[0] * 1e-9;
+	summary.p50 = sorted[n / 2] * 1e-9;
+	summary.p99 = sorted[n * 99 / 100] * 1e-9;
+
+	return summary;
+}
+
+bool SavePhaseTimes(const char* path)
+{
+	ofstream file(path);
+
+	if (!file)
+	{
+		cerr << "Cannot write phase times to " << path << endl;
+		return false;
+	}
+
+	file << "phase;count;total_s;min_us;p50_us;p99_us" << "\n";
+
+	for (int p = 0; p < NUM_PHASES; p++)
+	{
+		const auto s = SummarizePhase((Phase)p);
+
+		file << GetPhaseName((Phase)p) << ";" << s.count << ";" << s.total << ";"
+		     << s.min * 1e6 << ";" << s.p50 * 1e6 << ";" << s.p99 * 1e6 << "\n";
+	}
+
+	return true;
+}
@@ -0,0 +1,102 @@
+/******************************************************************
+*
+* PhaseTimers.h
+*
+* Description: Wall time of the phases of a time step and of a
+* displayed frame; a ScopedPhaseTimer measures its scope with the
+* steady clock and adds the duration to the samples of its phase
+*
+* Every phase keeps its last window samples, from which Summarize
+* computes min, median and 99th percentile, plus the count and total
+* of all samples. Samples are added with atomic operations, so any
+* thread may time any phase and the overlay may read while the
+* simulation thread writes.
+*
+* Timers exist only if MASS_SPRING_TIMING is defined (CMake option
+* of the same name); otherwise ScopedPhaseTimer is empty and compiles
+* to nothing. If compiled in, they measure only while enabled, which
+* costs one load per scope when disabled.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __PHASE_TIMERS_H__
+#define __PHASE_TIMERS_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+using namespace std;
+
+enum Phase
+{
+	PHASE_STEP,       /* Whole time step (Scene::Update) */
+	PHASE_FORCES,     /* Spring forces of all points, part of integrate */
+	PHASE_INTEGRATE,  /* Update of the solver */
+	PHASE_REFERENCE,  /* Analytical solution and error */
+	PHASE_CONTACTS,   /* Collision stage */
+	PHASE_RECORD,     /* Trajectory record */
+	PHASE_SNAPSHOT,   /* Copy for drawing */
+	PHASE_RENDER,     /* Drawing of a frame */
+	PHASE_SWAP,       /* Buffer swap, includes waiting for vsync */
+	NUM_PHASES
+};
+
+/* Statistics of one phase in seconds; min, p50 and p99 are those of
+   the last samples only */
+struct PhaseSummary
+{
+	long count;
+	double total;
+	double min, p50, p99;
+};
+
+static constexpr int phase_window = 1024;
+
+extern atomic<bool> phase_timers_enabled;
+
+const char* GetPhaseName(Phase phase);
+void EnablePhaseTimers(bool enable);
+void AddPhaseSample(Phase phase, uint64_t nanoseconds);
+PhaseSummary SummarizePhase(Phase phase);
+bool SavePhaseTimes(const char* path); /* ";"-separated, one row per phase */
+
+class ScopedPhaseTimer
+{
+#ifdef MASS_SPRING_TIMING
+private:
+	Phase phase;
+	bool active;
+	chrono::steady_clock::time_point start;
+
+public:
+	explicit ScopedPhaseTimer(const Phase _phase)
+		: phase(_phase), active(phase_timers_enabled.load(memory_order_relaxed))
+	{
+		if (active)
+			start = chrono::steady_clock::now();
+	}
+
+	~ScopedPhaseTimer(void)
+	{
+		if (active)
+			AddPhaseSample(phase, (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+				chrono::steady_clock::now() - start).count());
+	}
+#else
+public:
+	explicit ScopedPhaseTimer(Phase)
+	{
+	}
+#endif
+
+	ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+	ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+};
+
+#endif
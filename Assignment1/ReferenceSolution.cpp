@@ -0,0 +1,249 @@
+/******************************************************************
+*
+* ReferenceSolution.cpp
+*
+* Description: Per-spring constants and batched evaluation of the
+* closed-form reference, see ReferenceSolution.h
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <cassert>
+#include <cmath>
+
+#include "ReferenceSolution.h"
+
+/* Gravity, as in Exercise.cpp */
+static constexpr double g = -10.0;
+
+void ReferenceSolution::Init(const ParticleSystem& particles, const vector<Spring>& springs,
+                             const Adjacency& adjacency)
+{
+	entries.clear();
+	modes.clear();
+
+	for (int i = 0; i < particles.Size(); i++)
+	{
+		if (particles.IsFixed(i))
+			continue;
+
+		const auto m = particles.GetMass(i);
+		const auto d = particles.damping[i];
+
+		for (auto it = adjacency.begin(i); it != adjacency.end(i); ++it)
+		{
+			const auto& spring = springs[it->spring];
+			const auto k = spring.getStiffness();
+
+			const auto wr = d / (2 * m);
+			const auto w = sqrt(k / m);
+
+			// ensure under-damping
+			assert(wr * wr < w * w && d < 2 * sqrt(m * k));
+
+			const auto wbar = sqrt(w * w - wr * wr);
+
+			/* Test cases use one mass, damping and stiffness, so this
+			   search ends at the first mode */
+			auto mode = 0;
+
+			while (mode < (int)modes.size() && (modes[mode].wr != wr || modes[mode].wbar != wbar))
+				mode++;
+
+			if (mode == (int)modes.size())
+				modes.push_back(Mode{ wr, wbar, wr / wbar });
+
+			entries.push_back(Entry{ i, it->other, mode, m * g / k, 0.0, 0.0, spring.getRestLength() });
+		}
+	}
+
+	times.resize(batch);
+	shapes.resize(modes.size() * batch);
+	sines.resize(modes.size() * batch);
+
+	origin = 0.0;
+	reparameterized = false;
+
+	Reset();
+}
+
+/******************************************************************
+*
+* Reparameterize
+*
+* Distance q0 and rate q0' of every entry at time by the constants
+* so far, then new constants and A, B and q0 of the oscillators
+* continuing from there (see ReferenceSolution.h)
+*
+*******************************************************************/
+
+void ReferenceSolution::Reparameterize(const double time, const ParticleSystem& particles,
+                                       const vector<Spring>& springs, const Adjacency& adjacency)
+{
+	const auto t = time - origin;
+	const auto n = entries.size();
+
+	vector<double> distance(n), rate(n);
+
+	for (size_t k = 0; k < n; k++)
+	{
+		const auto& entry = entries[k];
+		const auto& mode = modes[entry.mode];
+
+		const auto e = exp(-mode.wr * t);
+		const auto c = e * cos(mode.wbar * t);
+		const auto s = e * sin(mode.wbar * t);
+
+		/* Derivatives of exp(-wr t) cos(wbar t) and exp(-wr t) sin(wbar t) */
+		const auto dc = -mode.wr * c - mode.wbar * s;
+		const auto ds = -mode.wr * s + mode.wbar * c;
+
+		distance[k] = entry.scale * (c + mode.ratio * s - 1.0) + entry.sine * s + entry.offset;
+		rate[k] = entry.scale * (dc + mode.ratio * ds) + entry.sine * ds;
+	}
+
+	/* Same entries in the same order, with m g / k of the new parameters */
+	Init(particles, springs, adjacency);
+
+	assert(entries.size() == n);
+
+	for (size_t k = 0; k < n; k++)
+	{
+		auto& entry = entries[k];
+
+		entry.sine = rate[k] / modes[entry.mode].wbar;
+		entry.scale = distance[k] + entry.scale;
+		entry.offset = distance[k];
+	}
+
+	origin = time;
+	reparameterized = true;
+}
+
+void ReferenceSolution::GetTerms(vector<double>& terms, double& t0) const
+{
+	terms.resize(3 * entries.size());
+
+	for (size_t k = 0; k < entries.size(); k++)
+	{
+		terms[3 * k] = entries[k].scale;
+		terms[3 * k + 1] = entries[k].sine;
+		terms[3 * k + 2] = entries[k].offset;
+	}
+
+	t0 = origin;
+}
+
+bool ReferenceSolution::SetTerms(const vector<double>& terms, const double t0)
+{
+	if (terms.size() != 3 * entries.size())
+		return false;
+
+	reparameterized = false;
+
+	for (size_t k = 0; k < entries.size(); k++)
+	{
+		entries[k].scale = terms[3 * k];
+		entries[k].sine = terms[3 * k + 1];
+		entries[k].offset = terms[3 * k + 2];
+
+		reparameterized |= entries[k].sine != 0.0 || entries[k].offset != 0.0;
+	}
+
+	origin = t0;
+
+	Reset();
+
+	return true;
+}
+
+void ReferenceSolution::Reset()
+{
+	count = 0;
+	cursor = 0;
+}
+
+/******************************************************************
+*
+* Fill
+*
+* Evaluates E(t) - 1 of every mode for the sample at time and, if
+* step is known, the batch - 1 samples following every interval
+* steps. Sample times are summed step by step like the simulated
+* time, so they compare equal to it; the modes are evaluated at the
+* time since the last parameter change.
+*
+*******************************************************************/
+
+void ReferenceSolution::Fill(const double time, const double step, const int interval)
+{
+	count = step > 0.0 ? batch : 1;
+	cursor = 0;
+
+	auto t = time;
+
+	for (int j = 0; j < count; j++)
+	{
+		times[j] = t;
+
+		for (int s = 0; s < interval; s++)
+			t += step;
+	}
+
+	const auto sample = times.data();
+
+	for (size_t mode = 0; mode < modes.size(); mode++)
+	{
+		const auto wr = modes[mode].wr;
+		const auto wbar = modes[mode].wbar;
+		const auto ratio = modes[mode].ratio;
+		const auto shape = &shapes[mode * batch];
+
+		#pragma omp simd
+		for (int j = 0; j < count; j++)
+			shape[j] = reference_shape(wr, wbar, ratio, sample[j] - origin);
+
+		if (!reparameterized)
+			continue;
+
+		const auto sine = &sines[mode * batch];
+
+		#pragma omp simd
+		for (int j = 0; j < count; j++)
+			sine[j] = reference_sine(wr, wbar, sample[j] - origin);
+	}
+}
+
+void ReferenceSolution::Evaluate(const double time, const double step, const int interval,
+                                 ParticleSystem& reference)
+{
+	if (cursor >= count || times[cursor] != time)
+		Fill(time, step, interval);
+
+	const auto j = cursor++;
+
+	/* Points move in order; later points see the new positions of
+	   earlier ones */
+	for (const auto& entry : entries)
+	{
+		const auto cx = reference.x[entry.other] - reference.x[entry.point];
+		const auto cy = reference.y[entry.other] - reference.y[entry.point];
+
+		const auto length = sqrt(cx * cx + cy * cy);
+		const auto dx = cx / length;
+		const auto dy = cy / length;
+
+		auto x = reference_offset(dy, entry.scale, shapes[entry.mode * batch + j], entry.restLength);
+
+		if (reparameterized)
+			x += (dy < 0.0 ? -dy : dy) * (entry.sine * sines[entry.mode * batch + j] + entry.offset);
+
+		reference.x[entry.point] = reference.x[entry.other] + x * dx;
+		reference.y[entry.point] = reference.y[entry.other] + x * dy;
+	}
+}
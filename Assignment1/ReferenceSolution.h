@@ -0,0 +1,141 @@
+/******************************************************************
+*
+* ReferenceSolution.h
+*
+* Description: Closed-form reference of the analytical test cases.
+* Every free point hangs from its incident springs as an underdamped
+* oscillator; its distance to the spring's other end point is
+*
+*   x(t) = |dir.y| m g / k (E(t) - 1) - l
+*   E(t) = exp(-wr t) (cos(wbar t) + wr / wbar sin(wbar t))
+*
+* with wr = d / 2m and wbar = sqrt(k / m - wr^2). The direction comes
+* from the current reference points, everything else is fixed per
+* parameter set: Init computes wr, wbar and m g / k per incident
+* spring, and springs with the same wr and wbar share one mode.
+*
+* When mass, stiffness or damping change at time t0, every point
+* continues from its current distance q0 and rate q0' as oscillator of
+* the new parameters; with S(t) = exp(-wr t) sin(wbar t), t' = t - t0
+* and the new constants
+*
+*   x(t) = |dir.y| (A (E(t') - 1) + B S(t') + q0) - l
+*
+* where A = q0 - q_eq with q_eq = -m g / k, and B = q0' / wbar. Before
+* any change t0 = 0, A = m g / k and B = q0 = 0, which is the closed
+* form above.
+*
+* E(t) of all modes is evaluated for a batch of upcoming sample
+* times at once, in loops the compiler vectorizes (VectorMath.h);
+* fixed steps of length h sampled every k steps hit the batch until
+* it runs out. Adaptive steps pass no step and get batches of one.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __REFERENCE_SOLUTION_H__
+#define __REFERENCE_SOLUTION_H__
+
+#include <vector>
+using namespace std;
+
+#include "ParticleSystem.h"
+#include "Spring.h"
+#include "Adjacency.h"
+#include "VectorMath.h"
+
+/* E(t) - 1 of a mode; shared with Ensemble.cpp so both give the same bits */
+inline double reference_shape(const double wr, const double wbar, const double ratio,
+                              const double t)
+{
+	double s, c;
+	simd_sincos(wbar * t, s, c);
+
+	return simd_exp(-wr * t) * (c + ratio * s) - 1.0;
+}
+
+/* S(t) of a mode, the decaying sine of reparameterized references */
+inline double reference_sine(const double wr, const double wbar, const double t)
+{
+	double s, c;
+	simd_sincos(wbar * t, s, c);
+
+	return simd_exp(-wr * t) * s;
+}
+
+/* Distance of a point to the other end of its spring */
+inline double reference_offset(const double dy, const double scale, const double shape,
+                               const double restLength)
+{
+	return (dy < 0.0 ? -dy : dy) * scale * shape - restLength;
+}
+
+class ReferenceSolution
+{
+private:
+	/* Incident spring of a free point, in evaluation order */
+	struct Entry
+	{
+		int point;
+		int other;
+		int mode;
+		double scale;        /* A, m g / k from rest */
+		double sine;         /* B, 0 from rest */
+		double offset;       /* q0, 0 from rest */
+		double restLength;
+	};
+
+	/* Damped oscillation shared by springs of equal wr and wbar */
+	struct Mode
+	{
+		double wr;           /* Decay rate */
+		double wbar;         /* Damped frequency */
+		double ratio;        /* wr / wbar */
+	};
+
+	vector<Entry> entries;
+	vector<Mode> modes;
+
+	/* Sample times and E(t) - 1 per mode, shapes[mode * batch + j] */
+	static constexpr int batch = 64;
+
+	vector<double> times;
+	vector<double> shapes;
+	vector<double> sines;    /* S(t) per mode, only if reparameterized */
+	int count = 0;           /* Valid samples in the batch */
+	int cursor = 0;          /* Next sample to use */
+
+	double origin = 0.0;     /* Time t0 of the last parameter change */
+	bool reparameterized = false;
+
+	void Fill(double time, double step, int interval);
+
+public:
+	/* Constants of the current parameter set; clears the batch */
+	void Init(const ParticleSystem& particles, const vector<Spring>& springs,
+	          const Adjacency& adjacency);
+
+	/* Forget cached samples, e.g. when time restarts at zero */
+	void Reset();
+
+	/* Continue from the reference at time with the parameters now in
+	   particles and springs; topology and fixed points are unchanged */
+	void Reparameterize(double time, const ParticleSystem& particles,
+	                    const vector<Spring>& springs, const Adjacency& adjacency);
+
+	/* A, B and q0 of every entry and t0, e.g. for checkpoints; Set
+	   returns false, if terms do not belong to this scene */
+	void GetTerms(vector<double>& terms, double& t0) const;
+	bool SetTerms(const vector<double>& terms, double t0);
+
+	/* Move the reference points to time; the following samples are
+	   expected every interval steps of length step, 0 if unknown */
+	void Evaluate(double time, double step, int interval, ParticleSystem& reference);
+};
+
+#endif
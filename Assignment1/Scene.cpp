@@ -4,7 +4,8 @@
 *
 * Description: Setup of 2D simulation scenes; three different scene
 * configurations are hard-coded - a hanging mass, a hanging triangle,
-* a falling triangle;  
+* a falling triangle; larger cloth, lattice and chain scenes are
+* generated by SceneGenerators.cpp
 *
 * Physically-Based Simulation Proseminar WS 2015
 * 
@@ -16,34 +17,152 @@
 
 /* Standard includes */
 #define _USE_MATH_DEFINES
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
 #include <stdlib.h>
 #include <iostream>
+#include <sstream>
 
 using namespace std;
 
 /* Local includes */
 #include "Scene.h"
-#include "Point.h"
+#include "ParticleSystem.h"
 #include "Spring.h"
+#include "Adjacency.h"
+#include "SpringColoring.h"
+#include "SimulationState.h"
+#include "SceneFile.h"
 #include "Vec2.h"
+#include "PhaseTimers.h"
+#include "TaskPool.h"
 
-/* External function for implementing the different numerical solvers */
-extern void TimeStep(double dt, Scene::Method method,
-                     vector<Point>& points, vector<Spring>& springs, bool userForce);
-extern void reset_time(const double dt);
+/* External function selecting the numerical solver */
+/* Instantiated for double and float (Exercise.cpp) */
+template<class Real>
+BasicStepFunction<Real> GetStepFunction(Scene::Method method, Scene::Stepping stepping, bool analytical);
+
+/* Trajectory of the interactive application, see TrajectoryDump */
+static const char* const interactive_trajectory = "./lastrun.traj";
+
+/* Checkpoint of the interactive application, written on request */
+static const char* const interactive_checkpoint = "./lastrun.ckpt";
+
+/* Last version of spring end points handed out; unique across scenes,
+   as one snapshot buffer may be filled by several scenes in turn */
+static atomic<unsigned long> topologies{0};
+
+static const char* const method_names[] = { "euler", "symplectic", "leapfrog", "midpoint", "implicit", "verlet", "adaptive",
+                                              "rk2", "rk4", "rk45", "xpbd" };
+static const char* const testcase_names[] = { "spring1D", "hanging", "falling", "cloth", "lattice", "chains" };
+static const char* const stepping_names[] = { "inplace", "twophase" };
+static const char* const precision_names[] = { "double", "float" };
+
+const char* Scene::GetMethodName(Method m)
+{
+	return method_names[m];
+}
+
+bool Scene::ParseMethod(const char* name, Method& m)
+{
+	for (int i = 0; i < (int)(sizeof(method_names) / sizeof(*method_names)); i++)
+	{
+		if (!strcmp(name, method_names[i]))
+		{
+			m = (Method)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Scene::IsAdaptive(Method m)
+{
+	return m == ADAPTIVE || m == RK45;
+}
+
+const char* Scene::GetTestcaseName(Testcase t)
+{
+	return testcase_names[t];
+}
+
+bool Scene::ParseTestcase(const char* name, Testcase& t)
+{
+	for (int i = 0; i < (int)(sizeof(testcase_names) / sizeof(*testcase_names)); i++)
+	{
+		if (!strcmp(name, testcase_names[i]))
+		{
+			t = (Testcase)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char* Scene::GetSteppingName(Stepping s)
+{
+	return stepping_names[s];
+}
+
+bool Scene::ParseStepping(const char* name, Stepping& s)
+{
+	for (int i = 0; i < (int)(sizeof(stepping_names) / sizeof(*stepping_names)); i++)
+	{
+		if (!strcmp(name, stepping_names[i]))
+		{
+			s = (Stepping)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char* Scene::GetPrecisionName(Precision p)
+{
+	return precision_names[p];
+}
+
+bool Scene::ParsePrecision(const char* name, Precision& p)
+{
+	for (int i = 0; i < (int)(sizeof(precision_names) / sizeof(*precision_names)); i++)
+	{
+		if (!strcmp(name, precision_names[i]))
+		{
+			p = (Precision)i;
+			return true;
+		}
+	}
+
+	return false;
+}
 
 Scene::Scene(void)
 {
 	/* Default simulation parameters */
 	testcase = SPRING;
 	method = EULER;
+	stepping = INPLACE;
+	precision = DOUBLE;
 	stiffness = 60.0;
 	mass = 0.15;
 	step = 0.003;
+	tolerance = 1e-4;
+	sample = 1;
+	substeps = 10;
+	iterations = 1;
 	damping = 0.08;
 	interaction = false;
+	contacts = false;
+	ground = -2.5;
+	size = 32;
+	checkpointFile = interactive_checkpoint;
+	autosave = 0.0;
+	nextAutosave = 0.0;
 
 
 	initial_stiffness = stiffness;
@@ -51,19 +170,72 @@ Scene::Scene(void)
 	initial_damping = damping;
 	initial_step = step;
 	Init();
+	Record(interactive_trajectory, false);
 	PrintSettings();
 }
 
+Scene::Scene(Method _method, Testcase _testcase, double _step,
+             double _mass, double _stiffness, double _damping, int _size)
+{
+	/* Explicit parameters for headless runs; no recording, no console output */
+	testcase = _testcase;
+	method = _method;
+	stepping = INPLACE;
+	precision = DOUBLE;
+	stiffness = _stiffness;
+	mass = _mass;
+	step = _step;
+	tolerance = 1e-4;
+	sample = 1;
+	substeps = 10;
+	iterations = 1;
+	damping = _damping;
+	interaction = false;
+	contacts = false;
+	ground = -2.5;
+	size = _size;
+	checkpointFile = interactive_checkpoint;
+	autosave = 0.0;
+	nextAutosave = 0.0;
+
+	initial_stiffness = stiffness;
+	initial_mass = mass;
+	initial_damping = damping;
+	initial_step = step;
+	Init();
+}
+
 Scene::Scene(int argc, char* argv[])
 {
 	/* Default simulation parameters */
 	testcase = SPRING;
 	method = EULER;
+	stepping = INPLACE;
+	precision = DOUBLE;
 	stiffness = 60.0;
 	mass = 0.15;
 	step = 0.003;
+	tolerance = 1e-4;
+	sample = 1;
+	substeps = 10;
+	iterations = 1;
 	damping = 0.08;
 	interaction = false;
+	contacts = false;
+	ground = -2.5;
+	size = 32;
+	checkpointFile = interactive_checkpoint;
+	autosave = 0.0;
+	nextAutosave = 0.0;
+
+	/* Binary scene to write after setup */
+	const char* savePath = nullptr;
+
+	/* Checkpoint to continue from instead of the setup */
+	const char* restorePath = nullptr;
+
+	/* Record positions and velocities in addition to the error */
+	auto fullState = false;
 
 	/* Check for parameters in command line */
 	int arg = 1;
@@ -75,19 +247,7 @@ Scene::Scene(int argc, char* argv[])
 		{
 			arg++;
 
-			if (!strcmp(argv[arg], "spring1D"))
-			{
-				testcase = SPRING;
-			}
-			else if (!strcmp(argv[arg], "hanging"))
-			{
-				testcase = HANGING;
-			}
-			else if (!strcmp(argv[arg], "falling"))
-			{
-				testcase = FALLING;
-			}
-			else
+			if (!ParseTestcase(argv[arg], testcase))
 			{
 				cerr << "Unrecognized testcase: " << argv[arg] << endl;
 				exit(1);
@@ -101,35 +261,90 @@ Scene::Scene(int argc, char* argv[])
 		{
 			arg++;
 
-			if (!strcmp(argv[arg], "euler"))
+			if (!ParseMethod(argv[arg], method))
 			{
-				method = EULER;
+				cerr << "Unrecognized method: " << argv[arg] << endl;
+				exit(1);
 			}
-			else if (!strcmp(argv[arg], "symplectic"))
+
+			arg++;
+		}
+
+			/* Check for update order of explicit methods */
+		else if (!strcmp(argv[arg], "-stepping"))
+		{
+			arg++;
+
+			if (!ParseStepping(argv[arg], stepping))
 			{
-				method = SYMPLECTIC;
+				cerr << "Unrecognized stepping: " << argv[arg] << endl;
+				exit(1);
 			}
-			else if (!strcmp(argv[arg], "leapfrog"))
+
+			arg++;
+		}
+
+			/* Check for scalar type of the solver */
+		else if (!strcmp(argv[arg], "-precision"))
+		{
+			arg++;
+
+			if (!ParsePrecision(argv[arg], precision))
 			{
-				method = LEAPFROG;
+				cerr << "Unrecognized precision: " << argv[arg] << endl;
+				exit(1);
 			}
-			else if (!strcmp(argv[arg], "midpoint"))
+
+			arg++;
+		}
+
+			/* Check for step size */
+		else if (!strcmp(argv[arg], "-step"))
+		{
+			step = (double)atof(argv[++arg]);
+			arg++;
+		}
+
+			/* Check for error tolerance of the adaptive method */
+		else if (!strcmp(argv[arg], "-tol"))
+		{
+			tolerance = (double)atof(argv[++arg]);
+			arg++;
+		}
+
+			/* Check for interval of the error against the analytical solution */
+		else if (!strcmp(argv[arg], "-sample"))
+		{
+			sample = atoi(argv[++arg]);
+			arg++;
+
+			if (sample < 1)
 			{
-				method = MIDPOINT;
+				cerr << "Sample interval must be at least 1" << endl;
+				exit(1);
 			}
-			else
+		}
+
+			/* Check for collision handling */
+		else if (!strcmp(argv[arg], "-contacts"))
+		{
+			arg++;
+
+			if (!strcmp(argv[arg], "on"))
+				contacts = true;
+			else if (strcmp(argv[arg], "off"))
 			{
-				cerr << "Unrecognized method: " << argv[arg] << endl;
+				cerr << "Unrecognized contacts setting: " << argv[arg] << endl;
 				exit(1);
 			}
 
 			arg++;
 		}
 
-			/* Check for step size */
-		else if (!strcmp(argv[arg], "-step"))
+			/* Check for height of the ground line */
+		else if (!strcmp(argv[arg], "-ground"))
 		{
-			step = (double)atof(argv[++arg]);
+			ground = (double)atof(argv[++arg]);
 			arg++;
 		}
 
@@ -154,18 +369,141 @@ Scene::Scene(int argc, char* argv[])
 			arg++;
 		}
 
+			/* Check for size of generated scenes */
+		else if (!strcmp(argv[arg], "-size"))
+		{
+			size = atoi(argv[++arg]);
+			arg++;
+
+			if (size < 2)
+			{
+				cerr << "Size must be at least 2" << endl;
+				exit(1);
+			}
+		}
+
+			/* Check for binary scene to load instead of the testcase */
+		else if (!strcmp(argv[arg], "-scene"))
+		{
+			sceneFile = argv[++arg];
+			arg++;
+		}
+
+			/* Check for binary scene to write */
+		else if (!strcmp(argv[arg], "-save"))
+		{
+			savePath = argv[++arg];
+			arg++;
+		}
+
+			/* Check for checkpoint to continue from */
+		else if (!strcmp(argv[arg], "-restore"))
+		{
+			restorePath = argv[++arg];
+			arg++;
+		}
+
+			/* Check for target of checkpoints */
+		else if (!strcmp(argv[arg], "-checkpoint"))
+		{
+			checkpointFile = argv[++arg];
+			arg++;
+		}
+
+			/* Check for interval of periodic checkpoints */
+		else if (!strcmp(argv[arg], "-autosave"))
+		{
+			autosave = (double)atof(argv[++arg]);
+			arg++;
+		}
+
+			/* Check for substeps of XPBD */
+		else if (!strcmp(argv[arg], "-substeps"))
+		{
+			substeps = atoi(argv[++arg]);
+			arg++;
+
+			if (substeps < 1)
+			{
+				cerr << "Substeps must be at least 1" << endl;
+				exit(1);
+			}
+		}
+
+			/* Check for constraint sweeps per substep of XPBD */
+		else if (!strcmp(argv[arg], "-iterations"))
+		{
+			iterations = atoi(argv[++arg]);
+			arg++;
+
+			if (iterations < 1)
+			{
+				cerr << "Iterations must be at least 1" << endl;
+				exit(1);
+			}
+		}
+
+			/* Check for threads of the parallel loops */
+		else if (!strcmp(argv[arg], "-threads"))
+		{
+			const auto threads = atoi(argv[++arg]);
+			arg++;
+
+			if (threads < 0)
+			{
+				cerr << "Threads must be at least 0" << endl;
+				exit(1);
+			}
+
+			SetWorkerThreads(threads);
+		}
+
+			/* Check for contents of the trajectory */
+		else if (!strcmp(argv[arg], "-record"))
+		{
+			arg++;
+
+			if (!strcmp(argv[arg], "states"))
+				fullState = true;
+			else if (strcmp(argv[arg], "rms"))
+			{
+				cerr << "Unrecognized record mode: " << argv[arg] << endl;
+				exit(1);
+			}
+
+			arg++;
+		}
+
 			/* Incorrect command line option; exit with message */
 		else
 		{
 			cerr << endl << "Unrecognized option: " << argv[arg] << endl;
 			cerr << "Usage: ./MassSpring -[option1] [setting1] -[option2] [setting2] ..." << endl;
 			cerr << "Options:" << endl;
-			cerr << "\t-testcase [spring, hanging, falling]" << endl;
-			cerr << "\t-method [euler, symplectic, leapfrog, midpoint]" << endl;
-			cerr << "\t-step [step size]" << endl;
+			cerr << "\t-testcase [spring1D, hanging, falling, cloth, lattice, chains]" << endl;
+			cerr << "\t-method [euler, symplectic, leapfrog, midpoint, implicit, verlet, adaptive," << endl;
+			cerr << "\t         rk2, rk4, rk45, xpbd]" << endl;
+			cerr << "\t-stepping [inplace, twophase]" << endl;
+			cerr << "\t-precision [double, float] (scalar type of the solver)" << endl;
+			cerr << "\t-step [step size, initial step of adaptive, rk45]" << endl;
+			cerr << "\t-tol [error tolerance of adaptive, rk45]" << endl;
+			cerr << "\t-sample [steps between comparisons with the analytical solution]" << endl;
+			cerr << "\t-substeps [substeps per step of xpbd]" << endl;
+			cerr << "\t-iterations [constraint sweeps per substep of xpbd]" << endl;
 			cerr << "\t-stiff [stiffness]" << endl;
 			cerr << "\t-damp [damping]" << endl;
-			cerr << "\t-mass [mass]" << endl << endl;
+			cerr << "\t-mass [mass]" << endl;
+			cerr << "\t-contacts [on, off] (collisions between points and with the ground)" << endl;
+			cerr << "\t-ground [height of the ground line]" << endl;
+			cerr << "\t-size [points per side of cloth, lattice, chains]" << endl;
+			cerr << "\t-scene [binary scene file, replaces testcase]" << endl;
+			cerr << "\t-save [write scene to binary file]" << endl;
+			cerr << "\t-restore [checkpoint file to continue from]" << endl;
+			cerr << "\t-checkpoint [checkpoint file, default ./lastrun.ckpt]" << endl;
+			cerr << "\t-autosave [simulated seconds between checkpoints, 0 = off]" << endl;
+			cerr << "\t-threads [threads of the parallel loops, 0 = one per core;" << endl;
+			cerr << "\t          euler, symplectic, leapfrog, midpoint only with twophase]" << endl;
+			cerr << "\t-record [rms, states] (contents of ./lastrun.traj)" << endl << endl;
 			exit(1);
 			break;
 		}
@@ -175,8 +513,22 @@ Scene::Scene(int argc, char* argv[])
 	initial_mass = mass;
 	initial_damping = damping;
 	initial_step = step;
-	Init();
+
+	/* A checkpoint brings its own parameters and initial values */
+	if (restorePath)
+	{
+		if (!RestoreCheckpoint(restorePath))
+			exit(1);
+	}
+	else
+		Init();
+
+	nextAutosave = state.time + autosave;
+	Record(interactive_trajectory, fullState);
 	PrintSettings();
+
+	if (savePath && !Save(savePath))
+		exit(1);
 }
 
 Scene::~Scene(void)
@@ -187,43 +539,116 @@ void Scene::PrintSettings(void)
 {
 	cerr << endl << "Settings for testcase:" << endl;
 
-	cerr << "\t-method ";
-	switch (method)
-	{
-		case EULER:
-			cerr << "euler" << endl;
-			break;
+	cerr << "\t-method " << GetMethodName(method) << endl;
+	cerr << "\t-stepping " << GetSteppingName(stepping) << endl;
+	cerr << "\t-precision " << GetPrecisionName(precision) << endl;
 
-		case SYMPLECTIC:
-			cerr << "symplectic" << endl;
-			break;
+	cerr << "\t-mass " << mass << endl;
+	cerr << "\t-step " << step << endl;
 
-		case LEAPFROG:
-			cerr << "leapfrog" << endl;
-			break;
+	if (IsAdaptive(method))
+		cerr << "\t-tol " << tolerance << endl;
 
-		case MIDPOINT:
-			cerr << "midpoint" << endl;
-			break;
-	}
+	if (sample > 1)
+		cerr << "\t-sample " << sample << endl;
+
+	if (method == XPBD)
+		cerr << "\t-substeps " << substeps << " -iterations " << iterations << endl;
 
-	cerr << "\t-mass " << mass << endl;
-	cerr << "\t-step " << step << endl;
 	cerr << "\t-stiff " << stiffness << endl;
-	cerr << "\t-damp " << damping << endl << endl;
+	cerr << "\t-damp " << damping << endl;
+
+	if (contacts)
+		cerr << "\t-contacts on -ground " << ground << endl;
+
+	if (!sceneFile.empty())
+		cerr << "\t-scene " << sceneFile << " (" << particles.Size() << " points, "
+		     << springs.size() << " springs)" << endl;
+	else if (testcase >= CLOTH)
+		cerr << "\t-size " << size << " (" << particles.Size() << " points, "
+		     << springs.size() << " springs)" << endl;
+
+	cerr << "\t-threads " << GetWorkerThreads() << endl;
+
+	cerr << endl;
 }
 
 /******************************************************************
 *
 * Init
 *
-* Setup 2D simulation scenes; geometry for all three cases is 
-* hard-coded
+* Setup 2D simulation scenes; geometry for the three small cases is
+* hard-coded, the others are generated to fill the visible area
 *
 *******************************************************************/
 
 void Scene::Init(void)
 {
+	topology = ++topologies;
+
+	/* Adaptive stepping restarts from the initial step */
+	state.control.step = step;
+	state.control.tolerance = tolerance;
+	state.control.error = 1.0;
+	state.control.fsal = false;
+	state.sampling.interval = sample;
+	state.xpbd.substeps = substeps;
+	state.xpbd.iterations = iterations;
+
+	/* Points collide as discs of their drawn radius, set below */
+	state.contacts.enabled = contacts;
+	state.contacts.ground = ground;
+
+	/* Generated and loaded scenes have no analytical solution to compare with */
+	state.analytical = testcase < CLOTH && sceneFile.empty();
+	SelectStepper();
+	radius = 0.1;
+
+	if (!sceneFile.empty())
+	{
+		/* Masses, damping and stiffness come from the file */
+		if (!LoadSceneFile(sceneFile.c_str(), particles, springs))
+			exit(1);
+
+		/* Size points by their mean spring length */
+		auto length = 0.0;
+
+		for (const auto& spring : springs)
+			length += spring.getRestLength();
+
+		if (!springs.empty())
+			radius = min(0.1, 0.3 * length / springs.size());
+
+		state.contacts.radius = radius;
+
+		adjacency.Build(particles.Size(), springs);
+		coloring.Build(particles.Size(), springs);
+		Narrow();
+		return;
+	}
+
+	if (testcase >= CLOTH)
+	{
+		/* Size points per side spread over [-2.5, 2.5] */
+		const auto spacing = 5.0 / (size - 1);
+
+		radius = min(0.1, 0.3 * spacing);
+
+		if (testcase == CLOTH)
+			InitCloth(spacing);
+		else if (testcase == LATTICE)
+			InitLattice(spacing);
+		else
+			InitChains(spacing);
+
+		state.contacts.radius = radius;
+
+		adjacency.Build(particles.Size(), springs);
+		coloring.Build(particles.Size(), springs);
+		Narrow();
+		return;
+	}
+
 	Vec2 pt1(0.0, 1.0); /* Upper mass point for all example cases */
 	Vec2 pt2; /* Temporary 2D vectors, initialized to (0,0) */
 	Vec2 pt3;
@@ -246,8 +671,8 @@ void Scene::Init(void)
 	}
 
 	/* Allocate the first two mass points, assuming same mass and damping */
-	for (int i = 0; i < 2; i++)
-		points.push_back(Point(mass, damping));
+	particles.Add(pt1, mass, damping);
+	particles.Add(pt2, mass, damping);
 
 	/* Allocate the first spring */
 	springs.push_back(Spring(stiffness));
@@ -255,48 +680,289 @@ void Scene::Init(void)
 	/* For cases with triangle geometry, allocate additional point and springs */
 	if (testcase != SPRING)
 	{
-		points.push_back(Point(mass, damping));
+		particles.Add(pt3, mass, damping);
 		springs.push_back(Spring(stiffness));
 		springs.push_back(Spring(stiffness));
 	}
 
-	/* Set actual position of first two mass points */
-	points[0].setPos(pt1);
-	points[1].setPos(pt2);
-
 	/* Upper mass point fixed in first two example scenes */
 	if (testcase != FALLING)
-		points[0].setFixed(true);
+		particles.SetFixed(0, true);
 
 	/* Assign points of first spring (rest length impicit) */
-	springs[0].init(&points[0], &points[1]);
+	springs[0].init(0, 1, particles);
 
-	/* For triangle examples, setup additional point and springs */
+	/* For triangle examples, setup additional springs */
 	if (testcase != SPRING)
 	{
-		points[2].setPos(pt3);
-
 		/* Note: ordering of points for springs */
-		springs[1].init(&points[1], &points[2]);
-		springs[2].init(&points[2], &points[0]);
+		springs[1].init(1, 2, particles);
+		springs[2].init(2, 0, particles);
 
 		/* Set external node force vector on one mass point */
-		points[1].setUserForce(Vec2(0.5, 0.5));
+		particles.SetUserForce(1, Vec2(0.5, 0.5));
 	}
+
+	/* Index incident springs per point for the force evaluation */
+	adjacency.Build(particles.Size(), springs);
+	coloring.Build(particles.Size(), springs);
+
+	/* Constants of the closed form for this parameter set */
+	state.solution.Init(particles, springs, adjacency);
+	state.contacts.radius = radius;
+	Narrow();
 }
 
-void Scene::Update(void)
+bool Scene::Save(const char* path) const
 {
-	TimeStep(step, method, points, springs, interaction);
+	return SaveSceneFile(path, particles, springs);
 }
 
-void Scene::Render(void)
+void Scene::Capture(Checkpoint& checkpoint) const
 {
-	for (int i = 0; i < (int)springs.size(); i++)
-		springs[i].render();
+	/* Zero the padding, so equal states give equal files */
+	auto& s = checkpoint.scalars;
+	s = CheckpointScalars();
 
-	for (int i = 0; i < (int)points.size(); i++)
-		points[i].render();
+	s.method = method;
+	s.stepping = stepping;
+	s.precision = precision;
+	s.testcase = testcase;
+	s.size = size;
+	s.sample = sample;
+	s.substeps = substeps;
+	s.iterations = iterations;
+	s.interaction = interaction;
+	s.contacts = contacts;
+	s.analytical = state.analytical;
+	s.hasReference = state.hasReference;
+
+	s.step = step;
+	s.tolerance = tolerance;
+	s.mass = mass;
+	s.stiffness = stiffness;
+	s.damping = damping;
+	s.ground = ground;
+	s.radius = radius;
+	s.initialMass = initial_mass;
+	s.initialStiffness = initial_stiffness;
+	s.initialDamping = initial_damping;
+	s.initialStep = initial_step;
+
+	s.time = state.time;
+	s.error = state.error;
+	s.steps = state.steps;
+	s.control = state.control;
+	s.sampling = state.sampling;
+
+	ostringstream rng;
+	rng << state.rng;
+
+	checkpoint.rng = rng.str();
+	checkpoint.sceneFile = sceneFile;
+
+	/* Assignments reuse the storage of earlier checkpoints */
+	checkpoint.particles = particles;
+	checkpoint.springs = springs;
+
+	if (state.hasReference)
+	{
+		checkpoint.rx = state.reference.x;
+		checkpoint.ry = state.reference.y;
+	}
+
+	if (state.analytical)
+		state.solution.GetTerms(checkpoint.terms, s.referenceOrigin);
+	else
+		checkpoint.terms.clear();
+}
+
+/******************************************************************
+*
+* Restore
+*
+* Takes over parameters and state of a checkpoint and rebuilds what
+* Init derives from them; the scene is left unchanged, if the
+* checkpoint does not describe a valid scene
+*
+*******************************************************************/
+
+bool Scene::Restore(Checkpoint& checkpoint)
+{
+	const auto& s = checkpoint.scalars;
+
+	if (s.method < EULER || s.method > XPBD || s.stepping < INPLACE || s.stepping > TWOPHASE ||
+	    s.precision < DOUBLE || s.precision > FLOAT ||
+	    s.testcase < SPRING || s.testcase > CHAINS || s.sample < 1 || s.substeps < 1 ||
+	    s.iterations < 1)
+	{
+		cerr << "Checkpoint has invalid parameters" << endl;
+		return false;
+	}
+
+	default_random_engine rng;
+	istringstream text(checkpoint.rng);
+
+	if (!(text >> rng))
+	{
+		cerr << "Checkpoint has invalid random number state" << endl;
+		return false;
+	}
+
+	method = (Method)s.method;
+	stepping = (Stepping)s.stepping;
+	precision = (Precision)s.precision;
+	testcase = (Testcase)s.testcase;
+	size = s.size;
+	sample = s.sample;
+	substeps = s.substeps;
+	iterations = s.iterations;
+	interaction = s.interaction != 0;
+	contacts = s.contacts != 0;
+
+	step = s.step;
+	tolerance = s.tolerance;
+	mass = s.mass;
+	stiffness = s.stiffness;
+	damping = s.damping;
+	ground = s.ground;
+	radius = s.radius;
+	initial_mass = s.initialMass;
+	initial_stiffness = s.initialStiffness;
+	initial_damping = s.initialDamping;
+	initial_step = s.initialStep;
+	sceneFile = checkpoint.sceneFile;
+
+	/* The previous arrays are left for the next load or capture */
+	swap(particles, checkpoint.particles);
+	swap(springs, checkpoint.springs);
+	topology = ++topologies;
+
+	state.Reset();
+	state.time = s.time;
+	state.error = s.error;
+	state.steps = s.steps;
+	state.control = s.control;
+	state.sampling = s.sampling;
+	state.rng = rng;
+	state.xpbd.substeps = substeps;
+	state.xpbd.iterations = iterations;
+
+	/* Stages are not stored, the next step evaluates them again */
+	state.control.fsal = false;
+
+	state.contacts.enabled = contacts;
+	state.contacts.ground = ground;
+	state.contacts.radius = radius;
+
+	state.analytical = s.analytical != 0;
+	SelectStepper();
+
+	adjacency.Build(particles.Size(), springs);
+	coloring.Build(particles.Size(), springs);
+	Narrow();
+
+	if (state.analytical)
+	{
+		state.solution.Init(particles, springs, adjacency);
+
+		/* Terms of another scene can only come from a damaged file */
+		if (!checkpoint.terms.empty() && !state.solution.SetTerms(checkpoint.terms, s.referenceOrigin))
+			cerr << "Checkpoint reference does not match its scene, restarted from rest" << endl;
+	}
+
+	/* The reference differs from the points in its positions only */
+	if (s.hasReference)
+	{
+		state.reference = particles;
+		swap(state.reference.x, checkpoint.rx);
+		swap(state.reference.y, checkpoint.ry);
+		state.hasReference = true;
+	}
+
+	return true;
+}
+
+void Scene::SaveCheckpoint(const char* path)
+{
+	Capture(checkpoints.Begin());
+	checkpoints.Commit(path);
+}
+
+bool Scene::RestoreCheckpoint(const char* path)
+{
+	/* Waits for the file, if it is still being written */
+	auto& checkpoint = checkpoints.Spare();
+
+	if (!LoadCheckpoint(path, checkpoint) || !Restore(checkpoint))
+	{
+		cerr << "Cannot restore checkpoint: " << path << endl;
+		return false;
+	}
+
+	nextAutosave = state.time + autosave;
+
+	cerr << "Restored " << path << " at t = " << state.time << endl;
+
+	return true;
+}
+
+void Scene::FlushCheckpoints(void)
+{
+	checkpoints.Flush();
+}
+
+void Scene::AutoSave(void)
+{
+	if (autosave <= 0.0 || state.time < nextAutosave)
+		return;
+
+	SaveCheckpoint(checkpointFile.c_str());
+
+	nextAutosave = state.time + autosave;
+}
+
+const char* Scene::GetCheckpointFile() const
+{
+	return checkpointFile.c_str();
+}
+
+double Scene::Update(const double limit)
+{
+	/* Fixed-step methods ignore the limit */
+	const auto dt = IsAdaptive(method) ? limit : step;
+
+	ScopedPhaseTimer timer(PHASE_STEP);
+
+	if (precision == FLOAT)
+	{
+		const auto taken = stepperF32(dt, particlesF32, springsF32, adjacency, coloringF32,
+		                              state, interaction);
+		Widen();
+		return taken;
+	}
+
+	return stepper(dt, particles, springs, adjacency, coloring, state, interaction);
+}
+
+double Scene::Advance(const double duration)
+{
+	if (!IsAdaptive(method))
+	{
+		/* Whole steps only; the rest is carried over to the next call */
+		const auto steps = (long)(duration / step);
+
+		for (long i = 0; i < steps; i++)
+			Update();
+
+		return duration - steps * step;
+	}
+
+	/* The last step is shortened to end exactly after duration */
+	for (auto left = duration; left > 0.0; )
+		left -= Update(left);
+
+	return 0.0;
 }
 
 double Scene::GetStep(void) const
@@ -304,61 +970,347 @@ double Scene::GetStep(void) const
 	return step;
 }
 
+double Scene::GetTime(void) const
+{
+	return state.time;
+}
+
+const ErrorStats& Scene::GetError(void) const
+{
+	return state.error;
+}
+
+const StepStats& Scene::GetStepStats(void) const
+{
+	return state.steps;
+}
+
+void Scene::SetTolerance(const double tol)
+{
+	tolerance = tol;
+	state.control.tolerance = tol;
+}
+
+void Scene::SetSubsteps(const int n, const int sweeps)
+{
+	substeps = max(1, n);
+	iterations = max(1, sweeps);
+	state.xpbd.substeps = substeps;
+	state.xpbd.iterations = iterations;
+}
+
+void Scene::SetErrorInterval(const int k)
+{
+	sample = k;
+	state.sampling.interval = k;
+}
+
+bool Scene::Record(const char* path, const bool fullState)
+{
+	state.recorder = nullptr;
+
+	if (!recorder.Open(path, particles.Size(), fullState))
+	{
+		cerr << "Cannot write trajectory: " << path << endl;
+		return false;
+	}
+
+	state.recorder = &recorder;
+
+	return true;
+}
+
+void Scene::SetStepping(Stepping s)
+{
+	stepping = s;
+	SelectStepper();
+}
+
+/* Switching continues from the current state; stages kept by the
+   adaptive methods belong to the other precision */
+void Scene::SetPrecision(Precision p)
+{
+	precision = p;
+	state.control.fsal = false;
+	Narrow();
+}
+
+Scene::Precision Scene::GetPrecision() const
+{
+	return precision;
+}
+
+void Scene::SelectStepper(void)
+{
+	stepper = GetStepFunction<double>(method, stepping, state.analytical);
+	stepperF32 = GetStepFunction<float>(method, stepping, state.analytical);
+}
+
+/******************************************************************
+*
+* Narrow, Widen
+*
+* The double arrays are the state of the scene; with FLOAT precision
+* the solver steps a float copy of points, springs and colors, made
+* by Narrow after every change of the double arrays. Widen copies
+* positions and velocities back after every step, which is exact, so
+* a later Narrow restores the float state bit for bit.
+*
+*******************************************************************/
+
+void Scene::Narrow(void)
+{
+	if (precision != FLOAT)
+	{
+		particlesF32.Clear();
+		springsF32.clear();
+		coloringF32.Clear();
+		return;
+	}
+
+	particlesF32.Assign(particles);
+	springsF32.clear();
+
+	for (const auto& spring : springs)
+		springsF32.emplace_back(spring);
+
+	coloringF32.Build(particlesF32.Size(), springsF32);
+}
+
+void Scene::Widen(void)
+{
+	particles.x.assign(particlesF32.x.begin(), particlesF32.x.end());
+	particles.y.assign(particlesF32.y.begin(), particlesF32.y.end());
+	particles.vx.assign(particlesF32.vx.begin(), particlesF32.vx.end());
+	particles.vy.assign(particlesF32.vy.begin(), particlesF32.vy.end());
+}
+
+const ParticleSystem& Scene::GetParticles() const
+{
+	return particles;
+}
+
+const vector<Spring>& Scene::GetSprings() const
+{
+	return springs;
+}
+
+const Adjacency& Scene::GetAdjacency() const
+{
+	return adjacency;
+}
+
+void Scene::Snapshot(SceneSnapshot& snapshot) const
+{
+	/* Assignments reuse the storage of earlier snapshots */
+	snapshot.x = particles.x;
+	snapshot.y = particles.y;
+	snapshot.fixedMask = particles.fixedMask;
+
+	/* Springs only change with Init and Restore */
+	if (snapshot.topology != topology)
+	{
+		snapshot.ends.resize(2 * springs.size());
+
+		for (size_t j = 0; j < springs.size(); j++)
+		{
+			snapshot.ends[2 * j] = springs[j].getPoint(0);
+			snapshot.ends[2 * j + 1] = springs[j].getPoint(1);
+		}
+
+		snapshot.topology = topology;
+	}
+
+	snapshot.time = state.time;
+	snapshot.radius = radius;
+	snapshot.contacts = contacts;
+	snapshot.ground = ground;
+}
+
 void Scene::ToggleUserForce(void)
 {
 	interaction = !interaction;
 }
 
+void Scene::ToggleContacts(void)
+{
+	contacts = !contacts;
+	state.contacts.enabled = contacts;
+}
+
 void Scene::resetInitial()
 {
 	mass = initial_mass;
 	damping = initial_damping;
 	stiffness = initial_stiffness;
 	step = initial_step;
-	points.clear();
+	particles.Clear();
 	springs.clear();
 	Init();
 	PrintSettings();
-	reset_time(0);
+	state.Reset();
 }
 
-void Scene::increaseMass(const double value)
+/******************************************************************
+*
+* SetMass, SetStiffness, SetDamping, SetStep
+*
+* Change a parameter of the running simulation in place; positions,
+* velocities, time and error statistics are kept and the analytical
+* reference continues from the current time with the new parameters.
+* Testcases assign the value to every point or spring, the masses
+* and stiffnesses of a scene file are scaled by the relative change
+* and its damping is shifted by the change, but not below 0.
+*
+* Mass, stiffness and step must be positive and damping must not be
+* negative; other values are rejected with a message and the old
+* value is kept, since the relative changes of a scene file could
+* not be undone.
+*
+*******************************************************************/
+
+bool Scene::SetMass(const double value)
 {
+	if (!isfinite(value) || value <= 0.0)
+	{
+		cerr << "Mass must be positive, kept " << mass << endl;
+		return false;
+	}
 
-	this->mass+=value;
-	points.clear();
-	springs.clear();
-	Init();
-	PrintSettings();
-	reset_time(0);
+	const auto ratio = mass / value;
+
+	mass = value;
+
+	if (sceneFile.empty())
+		fill(particles.invMass.begin(), particles.invMass.end(), 1.0 / mass);
+	else
+	{
+		for (auto& invMass : particles.invMass)
+			invMass *= ratio;
+	}
+
+	Narrow();
+	Reparameterize();
+
+	return true;
+}
+
+bool Scene::SetStiffness(const double value)
+{
+	if (!isfinite(value) || value <= 0.0)
+	{
+		cerr << "Stiffness must be positive, kept " << stiffness << endl;
+		return false;
+	}
+
+	const auto ratio = value / stiffness;
+
+	stiffness = value;
+
+	for (auto& spring : springs)
+		spring.setStiffness(sceneFile.empty() ? stiffness : spring.getStiffness() * ratio);
+
+	/* Force kernels read the color ordered copy */
+	coloring.Gather(springs);
+
+	Narrow();
+	Reparameterize();
+
+	return true;
+}
+
+bool Scene::SetDamping(const double value)
+{
+	if (!isfinite(value) || value < 0.0)
+	{
+		cerr << "Damping must not be negative, kept " << damping << endl;
+		return false;
+	}
+
+	const auto change = value - damping;
+
+	damping = value;
+
+	if (sceneFile.empty())
+		fill(particles.damping.begin(), particles.damping.end(), damping);
+	else
+	{
+		for (auto& d : particles.damping)
+			d = max(0.0, d + change);
+	}
+
+	Narrow();
+	Reparameterize();
+
+	return true;
+}
+
+bool Scene::SetStep(const double value)
+{
+	if (!isfinite(value) || value <= 0.0)
+	{
+		cerr << "Step must be positive, kept " << step << endl;
+		return false;
+	}
+
+	step = value;
+
+	/* Adaptive methods continue with it as proposal */
+	state.control.step = step;
+
+	return true;
+}
+
+void Scene::Reparameterize(void)
+{
+	/* The last stage belongs to the old parameters */
+	state.control.fsal = false;
+
+	if (!state.analytical)
+		return;
+
+	/* Before the first step, the reference still starts at rest */
+	if (state.hasReference)
+		state.solution.Reparameterize(state.time, particles, springs, adjacency);
+	else
+		state.solution.Init(particles, springs, adjacency);
+}
+
+double Scene::GetMass(void) const
+{
+	return mass;
+}
+
+double Scene::GetStiffness(void) const
+{
+	return stiffness;
+}
+
+double Scene::GetDamping(void) const
+{
+	return damping;
+}
+
+void Scene::increaseMass(const double value)
+{
+	if (SetMass(mass + value))
+		PrintSettings();
 }
 
 void Scene::increaseStiff(const double value)
 {
-	this->stiffness+=value;
-	points.clear();
-	springs.clear();
-	Init();
-	PrintSettings();
-	reset_time(0);
+	if (SetStiffness(stiffness + value))
+		PrintSettings();
 }
 
 void Scene::increaseDamp(const double value)
 {
-	this->damping+=value;
-	points.clear();
-	springs.clear();
-	Init();
-	PrintSettings();
-	reset_time(0);
+	if (SetDamping(damping + value))
+		PrintSettings();
 }
 
 void Scene::increaseStep(const double value)
 {
-	this->step+=value;
-	points.clear();
-	springs.clear();
-	Init();
-	PrintSettings();
-	reset_time(0);
+	if (SetStep(step + value))
+		PrintSettings();
 }
@@ -15,33 +15,78 @@
 #ifndef __SCENE_H__
 #define __SCENE_H__
 
+#include <cmath>
+#include <string>
 #include <vector>
 using namespace std;
 
 #include "Spring.h"
-#include "Point.h"
+#include "ParticleSystem.h"
+#include "Adjacency.h"
+#include "SpringColoring.h"
+#include "SimulationState.h"
+#include "TrajectoryRecorder.h"
+#include "SceneSnapshot.h"
+#include "Checkpoint.h"
+
+/* One time step of a solver (Exercise.cpp); advances by dt, adaptive
+   methods by at most dt, and returns the length of the step taken */
+template<class Real>
+using BasicStepFunction = double (*)(double dt, BasicParticleSystem<Real>& particles,
+                                     vector<BasicSpring<Real>>& springs,
+                                     const Adjacency& adjacency,
+                                     const BasicSpringColoring<Real>& coloring,
+                                     SimulationState& state, bool userForce);
+
+typedef BasicStepFunction<double> StepFunction;
+typedef BasicStepFunction<float> StepFunctionF32;
 
 class Scene
 {
 public:
 	/* Numerical solver */
-	enum Method { EULER, SYMPLECTIC, LEAPFROG, MIDPOINT };
+	enum Method { EULER, SYMPLECTIC, LEAPFROG, MIDPOINT, IMPLICIT_EULER, VELOCITY_VERLET, ADAPTIVE,
+	              RK2, RK4, RK45, XPBD };
 
 	Method method;
 
-	/* Test scene */
-	enum Testcase { SPRING, HANGING, FALLING };
+	/* Update order of the explicit solvers */
+	enum Stepping { INPLACE, TWOPHASE };
+
+	Stepping stepping;
+
+	/* Scalar type the points are stepped in */
+	enum Precision { DOUBLE, FLOAT };
+
+	Precision precision;
+
+	/* Test scene; the last three are generated with size points per side */
+	enum Testcase { SPRING, HANGING, FALLING, CLOTH, LATTICE, CHAINS };
 
 	Testcase testcase;
 
 private:
 	/* Global simulation parameters */
-	double step;
+	double step; /* Initial step of the adaptive method */
+	double tolerance; /* Local error per step of the adaptive method */
+	int sample; /* Steps between comparisons with the analytical solution */
+	int substeps; /* Substeps per step of XPBD */
+	int iterations; /* Constraint sweeps per substep of XPBD */
 	double mass; /* Identical mass for all points */
 	double stiffness; /* Identical spring stiffness for all springs */
 	double damping; /* Identical damping for all points */
 	bool interaction; /* Toggle for (hard-coded) external force */
-
+	bool contacts; /* Toggle for point-point and ground collisions */
+	double ground; /* Height of the ground line */
+	int size; /* Points per side of generated scenes */
+	double radius; /* Drawn radius of mass points */
+	string sceneFile; /* Binary scene replacing the testcase, if set */
+	string checkpointFile; /* Target of SaveCheckpoint from the application */
+	double autosave; /* Simulated time between checkpoints, 0 = off */
+	double nextAutosave; /* Simulated time of the next checkpoint */
+	StepFunction stepper; /* Solver of method and stepping, set by Init */
+	StepFunctionF32 stepperF32; /* Same solver on the float copy */
+	unsigned long topology; /* Version of the spring end points, new on Init and Restore */
 
 	double initial_mass;
 	double initial_stiffness;
@@ -49,26 +94,92 @@ private:
 	double initial_step;
 
 protected:
-	vector<Point> points;
+	ParticleSystem particles;
 	vector<Spring> springs;
+	Adjacency adjacency; /* Point to incident spring index, rebuilt by Init */
+	SpringColoring coloring; /* Conflict-free spring batches, rebuilt by Init */
+
+	/* With FLOAT precision, the solver steps these copies; positions
+	   and velocities are copied back to particles after every step,
+	   so everything else reads the double arrays as usual */
+	ParticleSystemF32 particlesF32;
+	vector<SpringF32> springsF32;
+	SpringColoringF32 coloringF32;
+
+	SimulationState state; /* Time, reference solution and error statistics */
+	TrajectoryRecorder recorder; /* Per-step records, see Record() */
+	CheckpointWriter checkpoints; /* Background writes of SaveCheckpoint */
+
+	void Reparameterize(void); /* Reference and step control after a parameter change */
+	void SelectStepper(void); /* Solvers of method and stepping in both precisions */
+	void Narrow(void); /* Float copies from the double arrays, if stepped in float */
+	void Widen(void); /* Positions and velocities back from the float copy */
+	void Capture(Checkpoint& checkpoint) const; /* Copy the complete state */
+	bool Restore(Checkpoint& checkpoint); /* Take over the state, arrays are swapped */
 
 public:
 	Scene(void);
 	Scene(int argc, char* argv[]);
+	Scene(Method _method, Testcase _testcase, double _step,
+	      double _mass, double _stiffness, double _damping, int _size = 32);
 	~Scene(void);
 
 	void Init(void);
+	void InitCloth(double spacing); /* Generators (SceneGenerators.cpp) */
+	void InitLattice(double spacing);
+	void InitChains(double spacing);
+	bool Save(const char* path) const; /* Write points and springs as binary scene */
+	void SaveCheckpoint(const char* path); /* Copy the state, written in the background */
+	bool RestoreCheckpoint(const char* path); /* Continue from a checkpoint */
+	void FlushCheckpoints(void); /* Wait until all checkpoints are written */
+	void AutoSave(void); /* Checkpoint, if the autosave interval has passed */
+	const char* GetCheckpointFile() const;
 	void PrintSettings(void);
-	void Render(); /* Draw scene */
-	void Update(); /* Execute time step */
+	void Snapshot(SceneSnapshot& snapshot) const; /* Copy what is drawn */
+	double Update(double limit = HUGE_VAL); /* Execute time step of at most limit, return its length */
+	double Advance(double duration); /* Simulate duration, return time left for the next call */
 
 	double GetStep() const; /* Return time step */
+	double GetTime() const; /* Return simulated time */
+	const ErrorStats& GetError() const; /* Deviation from analytical solution */
+	const StepStats& GetStepStats() const; /* Accepted and rejected steps */
+	void SetTolerance(double tol);
+	void SetSubsteps(int n, int sweeps); /* Substeps and sweeps per substep of XPBD */
+	void SetErrorInterval(int k); /* Compare with the analytical solution every k steps */
+	bool Record(const char* path, bool fullState); /* Record every step to binary file */
+	void SetStepping(Stepping s);
+	void SetPrecision(Precision p);
+	Precision GetPrecision() const;
+	const ParticleSystem& GetParticles() const;
+	const vector<Spring>& GetSprings() const;
+	const Adjacency& GetAdjacency() const;
+
+	static const char* GetMethodName(Method m);
+	static bool ParseMethod(const char* name, Method& m);
+	static bool IsAdaptive(Method m); /* Variable step with error control */
+	static const char* GetTestcaseName(Testcase t);
+	static bool ParseTestcase(const char* name, Testcase& t);
+	static const char* GetSteppingName(Stepping s);
+	static bool ParseStepping(const char* name, Stepping& s);
+	static const char* GetPrecisionName(Precision p);
+	static bool ParsePrecision(const char* name, Precision& p);
 	void ToggleUserForce(); /* Toggle external force On/Off */
+	void ToggleContacts(); /* Toggle collisions On/Off */
+
+	/* Parameters of the running simulation, changed in place; false
+	   and the old value kept, if the new one is invalid */
+	bool SetMass(double m);
+	bool SetStiffness(double k);
+	bool SetDamping(double d);
+	bool SetStep(double h);
+	double GetMass() const;
+	double GetStiffness() const;
+	double GetDamping() const;
 
 	void increaseMass(double value);
 	void increaseStiff(double value);
 	void increaseDamp(double value);
-	void resetInitial();
+	void resetInitial(); /* Rebuild the scene with the initial parameters */
 
 	void increaseStep(double d);
 
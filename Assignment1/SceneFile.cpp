@@ -0,0 +1,253 @@
+/******************************************************************
+*
+* SceneFile.cpp
+*
+* Description: Reading and writing of binary scene files
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "SceneFile.h"
+#include "MappedFile.h"
+
+static const char scene_magic[8] = { 'M', 'S', 'S', 'C', 'E', 'N', 'E', 0 };
+static constexpr uint32_t scene_version = 1;
+static constexpr uint32_t scene_byte_order = 0x01020304;
+
+/* Byte offsets of the arrays within a file */
+struct SceneFileLayout
+{
+	size_t x, y, mass, damping, fixed;
+	size_t i0, i1, stiffness, restLength;
+	size_t end;
+};
+
+static size_t Align(const size_t offset)
+{
+	return (offset + 63) & ~size_t(63);
+}
+
+static SceneFileLayout GetLayout(const uint64_t numPoints, const uint64_t numSprings)
+{
+	const auto points = numPoints * sizeof(double);
+	const auto springs = numSprings * sizeof(double);
+	const auto indices = numSprings * sizeof(uint32_t);
+
+	SceneFileLayout layout;
+
+	layout.x = sizeof(SceneFileHeader);
+	layout.y = Align(layout.x + points);
+	layout.mass = Align(layout.y + points);
+	layout.damping = Align(layout.mass + points);
+	layout.fixed = Align(layout.damping + points);
+	layout.i0 = Align(layout.fixed + (numPoints + 63) / 64 * sizeof(uint64_t));
+	layout.i1 = Align(layout.i0 + indices);
+	layout.stiffness = Align(layout.i1 + indices);
+	layout.restLength = Align(layout.stiffness + springs);
+	layout.end = layout.restLength + springs;
+
+	return layout;
+}
+
+template<class T>
+static const T* ArrayAt(const MappedFile& file, const size_t offset)
+{
+	return reinterpret_cast<const T*>(file.Data() + offset);
+}
+
+bool LoadSceneFile(const char* path, ParticleSystem& particles, vector<Spring>& springs)
+{
+	MappedFile file;
+
+	if (!file.Open(path))
+	{
+		cerr << "Cannot open scene file: " << path << endl;
+		return false;
+	}
+
+	SceneFileHeader header;
+
+	if (file.Size() < sizeof(header))
+	{
+		cerr << "Scene file too short: " << path << endl;
+		return false;
+	}
+
+	memcpy(&header, file.Data(), sizeof(header));
+
+	if (memcmp(header.magic, scene_magic, sizeof(scene_magic)) || header.version != scene_version)
+	{
+		cerr << "Not a version " << scene_version << " scene file: " << path << endl;
+		return false;
+	}
+
+	if (header.byteOrder != scene_byte_order)
+	{
+		cerr << "Scene file written with different byte order: " << path << endl;
+		return false;
+	}
+
+	/* Indices are int in memory */
+	if (header.numPoints > 0x7fffffff || header.numSprings > 0x7fffffff)
+	{
+		cerr << "Scene file too large: " << path << endl;
+		return false;
+	}
+
+	const auto n = (int)header.numPoints;
+	const auto m = (int)header.numSprings;
+	const auto layout = GetLayout(n, m);
+
+	if (file.Size() < layout.end)
+	{
+		cerr << "Scene file truncated: " << path << endl;
+		return false;
+	}
+
+	const auto x = ArrayAt<double>(file, layout.x);
+	const auto y = ArrayAt<double>(file, layout.y);
+	const auto mass = ArrayAt<double>(file, layout.mass);
+	const auto damping = ArrayAt<double>(file, layout.damping);
+	const auto fixed = ArrayAt<uint64_t>(file, layout.fixed);
+	const auto i0 = ArrayAt<uint32_t>(file, layout.i0);
+	const auto i1 = ArrayAt<uint32_t>(file, layout.i1);
+	const auto stiffness = ArrayAt<double>(file, layout.stiffness);
+	const auto restLength = ArrayAt<double>(file, layout.restLength);
+
+	for (int s = 0; s < m; s++)
+	{
+		if (i0[s] >= (uint32_t)n || i1[s] >= (uint32_t)n)
+		{
+			cerr << "Spring " << s << " references missing point: " << path << endl;
+			return false;
+		}
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		if (!isfinite(mass[i]) || mass[i] <= 0.0)
+		{
+			cerr << "Point " << i << " has invalid mass " << mass[i] << ": " << path << endl;
+			return false;
+		}
+
+		if (!isfinite(damping[i]) || damping[i] < 0.0)
+		{
+			cerr << "Point " << i << " has invalid damping " << damping[i] << ": " << path << endl;
+			return false;
+		}
+	}
+
+	/* Arrays are copied as a whole straight out of the mapping */
+	particles.x.assign(x, x + n);
+	particles.y.assign(y, y + n);
+	particles.damping.assign(damping, damping + n);
+	particles.fixedMask.assign(fixed, fixed + (n + 63) / 64);
+
+	particles.vx.assign(n, 0.0);
+	particles.vy.assign(n, 0.0);
+	particles.fx.assign(n, 0.0);
+	particles.fy.assign(n, 0.0);
+	particles.ux.assign(n, 0.0);
+	particles.uy.assign(n, 0.0);
+
+	particles.invMass.resize(n);
+
+	for (int i = 0; i < n; i++)
+		particles.invMass[i] = 1.0 / mass[i];
+
+	springs.clear();
+	springs.reserve(m);
+
+	for (int s = 0; s < m; s++)
+	{
+		springs.push_back(Spring(stiffness[s]));
+		springs.back().init((int)i0[s], (int)i1[s], restLength[s]);
+	}
+
+	return true;
+}
+
+/* Writes an array at offset followed by zero padding up to end,
+   which becomes the new offset */
+static void WriteArray(ofstream& os, const void* data, const size_t bytes,
+                       size_t& offset, const size_t end)
+{
+	static const char zeros[64] = {};
+
+	os.write(static_cast<const char*>(data), bytes);
+	os.write(zeros, end - offset - bytes);
+
+	offset = end;
+}
+
+bool SaveSceneFile(const char* path, const ParticleSystem& particles, const vector<Spring>& springs)
+{
+	ofstream os(path, ios::binary | ios::trunc);
+
+	if (!os)
+	{
+		cerr << "Cannot write scene file: " << path << endl;
+		return false;
+	}
+
+	const auto n = particles.Size();
+	const auto m = (int)springs.size();
+	const auto layout = GetLayout(n, m);
+
+	SceneFileHeader header = {};
+	memcpy(header.magic, scene_magic, sizeof(scene_magic));
+	header.version = scene_version;
+	header.byteOrder = scene_byte_order;
+	header.numPoints = n;
+	header.numSprings = m;
+
+	vector<double> mass(n);
+
+	for (int i = 0; i < n; i++)
+		mass[i] = particles.GetMass(i);
+
+	vector<uint32_t> i0(m), i1(m);
+	vector<double> stiffness(m), restLength(m);
+
+	for (int s = 0; s < m; s++)
+	{
+		i0[s] = (uint32_t)springs[s].getPoint(0);
+		i1[s] = (uint32_t)springs[s].getPoint(1);
+		stiffness[s] = springs[s].getStiffness();
+		restLength[s] = springs[s].getRestLength();
+	}
+
+	const auto points = n * sizeof(double);
+
+	size_t offset = 0;
+
+	WriteArray(os, &header, sizeof(header), offset, layout.x);
+	WriteArray(os, particles.x.data(), points, offset, layout.y);
+	WriteArray(os, particles.y.data(), points, offset, layout.mass);
+	WriteArray(os, mass.data(), points, offset, layout.damping);
+	WriteArray(os, particles.damping.data(), points, offset, layout.fixed);
+	WriteArray(os, particles.fixedMask.data(), particles.fixedMask.size() * sizeof(uint64_t), offset, layout.i0);
+	WriteArray(os, i0.data(), m * sizeof(uint32_t), offset, layout.i1);
+	WriteArray(os, i1.data(), m * sizeof(uint32_t), offset, layout.stiffness);
+	WriteArray(os, stiffness.data(), m * sizeof(double), offset, layout.restLength);
+	WriteArray(os, restLength.data(), m * sizeof(double), offset, layout.end);
+
+	if (!os.flush())
+	{
+		cerr << "Error writing scene file: " << path << endl;
+		return false;
+	}
+
+	return true;
+}
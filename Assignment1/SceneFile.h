@@ -0,0 +1,59 @@
+/******************************************************************
+*
+* SceneFile.h
+*
+* Description: Compact binary scene format (*.msc) and its reader
+* and writer
+*
+* A 64 byte header is followed by flat arrays in the layout of the
+* simulation, each starting on a 64 byte boundary:
+*
+*   x, y, mass, damping     double[points]
+*   fixed                   uint64[(points + 63) / 64], bit per point
+*   i0, i1                  uint32[springs], end point indices
+*   stiffness, restLength   double[springs]
+*
+* Values are stored in host byte order; the header records the byte
+* order and the reader rejects files written on the other kind of
+* machine. Loading maps the file and fills every array with one bulk
+* copy, so loading is bound by I/O rather than parsing.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __SCENE_FILE_H__
+#define __SCENE_FILE_H__
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+#include "ParticleSystem.h"
+#include "Spring.h"
+
+struct SceneFileHeader
+{
+	char magic[8];          /* "MSSCENE" */
+	uint32_t version;
+	uint32_t byteOrder;     /* 0x01020304 as written by the host */
+	uint64_t numPoints;
+	uint64_t numSprings;
+	uint64_t reserved[4];
+};
+
+static_assert(sizeof(SceneFileHeader) == 64, "Scene file header must be 64 bytes");
+
+/* Replace points and springs by the contents of the file; prints the
+   reason to cerr and returns false, if the file cannot be used */
+bool LoadSceneFile(const char* path, ParticleSystem& particles, vector<Spring>& springs);
+
+/* Positions, masses, damping, fixed points and springs; velocities
+   and forces are not stored */
+bool SaveSceneFile(const char* path, const ParticleSystem& particles, const vector<Spring>& springs);
+
+#endif
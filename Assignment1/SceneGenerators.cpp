@@ -0,0 +1,183 @@
+/******************************************************************
+*
+* SceneGenerators.cpp
+*
+* Description: Procedural scenes of arbitrary size - a hanging cloth
+* grid, a hanging triangular lattice and randomly bending chains;
+* every generator reserves its arrays up front and runs in time
+* linear in the number of points, so scenes of millions of points are
+* set up in milliseconds
+*
+* All scenes span the area [-2.5, 2.5] x [-2.5, 2.5] with size points
+* per side, at identical mass, damping and stiffness.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+/* Standard includes */
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <random>
+
+using namespace std;
+
+/* Local includes */
+#include "Scene.h"
+#include "Vec2.h"
+
+static void AddSpring(vector<Spring>& springs, const double stiffness,
+                      const int p0, const int p1, const ParticleSystem& particles)
+{
+	springs.push_back(Spring(stiffness));
+	springs.back().init(p0, p1, particles);
+}
+
+/******************************************************************
+*
+* InitCloth
+*
+* size x size grid hanging from its top row; structural springs to
+* the right and lower neighbor, shear springs along both diagonals
+* and bend springs to the second neighbor in both directions
+*
+*******************************************************************/
+
+void Scene::InitCloth(const double spacing)
+{
+	const auto n = size;
+
+	particles.Reserve(n * n);
+	springs.reserve(2 * n * (n - 1) + 2 * (n - 1) * (n - 1) + 2 * n * (n - 2));
+
+	for (int j = 0; j < n; j++)
+	{
+		for (int i = 0; i < n; i++)
+			particles.Add(Vec2(-2.5 + i * spacing, 2.5 - j * spacing), mass, damping);
+	}
+
+	for (int i = 0; i < n; i++)
+		particles.SetFixed(i, true);
+
+	for (int j = 0; j < n; j++)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			const auto p = j * n + i;
+
+			/* Structural */
+			if (i + 1 < n)
+				AddSpring(springs, stiffness, p, p + 1, particles);
+			if (j + 1 < n)
+				AddSpring(springs, stiffness, p, p + n, particles);
+
+			/* Shear */
+			if (i + 1 < n && j + 1 < n)
+			{
+				AddSpring(springs, stiffness, p, p + n + 1, particles);
+				AddSpring(springs, stiffness, p + 1, p + n, particles);
+			}
+
+			/* Bend */
+			if (i + 2 < n)
+				AddSpring(springs, stiffness, p, p + 2, particles);
+			if (j + 2 < n)
+				AddSpring(springs, stiffness, p, p + 2 * n, particles);
+		}
+	}
+}
+
+/******************************************************************
+*
+* InitLattice
+*
+* size rows of size points, odd rows shifted by half a spacing, so
+* that every point connects to six neighbors through equilateral
+* triangles; hangs from its top row
+*
+*******************************************************************/
+
+void Scene::InitLattice(const double spacing)
+{
+	const auto n = size;
+	const auto height = spacing * sqrt(3.0) / 2.0;
+
+	particles.Reserve(n * n);
+	springs.reserve(n * (n - 1) + 2 * (n - 1) * n);
+
+	for (int j = 0; j < n; j++)
+	{
+		const auto shift = (j & 1) ? 0.25 * spacing : -0.25 * spacing;
+
+		for (int i = 0; i < n; i++)
+			particles.Add(Vec2(-2.5 + shift + i * spacing, 2.5 - j * height), mass, damping);
+	}
+
+	for (int i = 0; i < n; i++)
+		particles.SetFixed(i, true);
+
+	for (int j = 0; j < n; j++)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			const auto p = j * n + i;
+
+			if (i + 1 < n)
+				AddSpring(springs, stiffness, p, p + 1, particles);
+
+			if (j + 1 == n)
+				continue;
+
+			/* Lower neighbors are (i - 1, i) below even rows, (i, i + 1) below odd rows */
+			const auto left = (j & 1) ? i : i - 1;
+
+			if (left >= 0)
+				AddSpring(springs, stiffness, p, p + n + left - i, particles);
+			if (left + 1 < n)
+				AddSpring(springs, stiffness, p, p + n + left + 1 - i, particles);
+		}
+	}
+}
+
+/******************************************************************
+*
+* InitChains
+*
+* size chains of size points each, hanging from evenly spaced fixed
+* points on the top edge; every link points downwards within 60
+* degrees of the vertical, drawn from a fixed seed so the scene is
+* reproducible
+*
+*******************************************************************/
+
+void Scene::InitChains(const double spacing)
+{
+	const auto n = size;
+
+	particles.Reserve(n * n);
+	springs.reserve(n * (n - 1));
+
+	default_random_engine rng(n);
+	uniform_real_distribution<double> angle(-M_PI / 3.0, M_PI / 3.0);
+
+	for (int c = 0; c < n; c++)
+	{
+		Vec2 position(-2.5 + c * spacing, 2.5);
+
+		const auto first = particles.Add(position, mass, damping);
+		particles.SetFixed(first, true);
+
+		for (int i = 1; i < n; i++)
+		{
+			const auto a = angle(rng);
+			position = position + spacing * Vec2(sin(a), -cos(a));
+
+			const auto p = particles.Add(position, mass, damping);
+			AddSpring(springs, stiffness, p - 1, p, particles);
+		}
+	}
+}
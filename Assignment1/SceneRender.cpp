@@ -0,0 +1,68 @@
+/******************************************************************
+*
+* SceneRender.cpp
+*
+* Description: Legacy OpenGL drawing of springs and mass points from
+* a snapshot of the scene; kept apart from the simulation code so
+* headless tools can be built without GLUT
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <GL/freeglut.h>
+
+#include "SceneSnapshot.h"
+
+void SceneSnapshot::RenderGround() const
+{
+	/* Ground line of the collision stage */
+	if (contacts)
+	{
+		glColor3f(0.0, 0.5, 0.0);
+		glLineWidth(2);
+		glBegin(GL_LINES);
+		glVertex3d(-3.0, ground, 0.0);
+		glVertex3d(3.0, ground, 0.0);
+		glEnd();
+	}
+}
+
+void SceneSnapshot::Render() const
+{
+	RenderGround();
+
+	for (size_t j = 0; j < ends.size(); j += 2)
+	{
+		/* Render spring as gray line */
+		glColor3f(0.5, 0.5, 0.5);
+		glLineWidth(5);
+		glBegin(GL_LINES);
+		glVertex3d(x[ends[j]], y[ends[j]], 0.0);
+		glVertex3d(x[ends[j + 1]], y[ends[j + 1]], 0.0);
+		glEnd();
+	}
+
+	for (int i = 0; i < (int)x.size(); i++)
+	{
+		/* Fixed vertices displayed in blue, free in red */
+		if (IsFixed(i))
+			glColor3f(0.0, 0.0, 1.0);
+		else
+			glColor3f(1.0, 0.0, 0.0);
+
+		/* Assume 2D scene, Z-axis disregarded */
+		glTranslatef(
+			static_cast<float>(x[i]),
+			static_cast<float>(y[i]),
+			0.0);
+
+		/* Draw unshaded spheres; appear as filled circles */
+		glutSolidSphere(radius, 36, 36);
+		glLoadIdentity();
+	}
+}
@@ -0,0 +1,241 @@
+/******************************************************************
+*
+* SceneRenderer.cpp
+*
+* Description: Vertex packing and draw calls of the batched renderer,
+* see SceneRenderer.h; buffer objects are OpenGL 1.5 and their
+* functions are looked up at run time through GLUT, so no extension
+* loader is needed
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+
+#include "SceneRenderer.h"
+#include "PhaseTimers.h"
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+
+#ifndef GL_ELEMENT_ARRAY_BUFFER
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#endif
+
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+
+/* Width of the view in scene units, glOrtho(-3, 3) in MassSpring.cpp */
+static constexpr double view_width = 6.0;
+
+/* Seconds between updates of the overlay text */
+static constexpr double overlay_refresh = 0.25;
+
+/* Buffer object functions, null if not supported */
+typedef void (APIENTRY* GenBuffersFunction)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY* BindBufferFunction)(GLenum target, GLuint buffer);
+typedef void (APIENTRY* BufferDataFunction)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+typedef void (APIENTRY* BufferSubDataFunction)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data);
+
+static GenBuffersFunction genBuffers = nullptr;
+static BindBufferFunction bindBuffer = nullptr;
+static BufferDataFunction bufferData = nullptr;
+static BufferSubDataFunction bufferSubData = nullptr;
+
+void SceneRenderer::Init()
+{
+	genBuffers = (GenBuffersFunction)glutGetProcAddress("glGenBuffers");
+	bindBuffer = (BindBufferFunction)glutGetProcAddress("glBindBuffer");
+	bufferData = (BufferDataFunction)glutGetProcAddress("glBufferData");
+	bufferSubData = (BufferSubDataFunction)glutGetProcAddress("glBufferSubData");
+
+	hasBuffers = genBuffers && bindBuffer && bufferData && bufferSubData;
+
+	if (hasBuffers)
+		genBuffers(2, buffers);
+}
+
+/* Vertices of all points in the layout of the draw calls; the spring
+   indices only when the springs changed, which is returned */
+bool SceneRenderer::Pack(const SceneSnapshot& snapshot)
+{
+	const auto n = (int)snapshot.x.size();
+	const auto changed = snapshot.topology != topology;
+
+	if (changed)
+	{
+		lines.assign(snapshot.ends.begin(), snapshot.ends.end());
+		topology = snapshot.topology;
+	}
+
+	points.resize(2 * n);
+	colors.resize(3 * n);
+
+	for (int i = 0; i < n; i++)
+	{
+		points[2 * i] = (float)snapshot.x[i];
+		points[2 * i + 1] = (float)snapshot.y[i];
+
+		/* Fixed vertices displayed in blue, free in red */
+		const auto fixed = snapshot.IsFixed(i);
+
+		colors[3 * i] = fixed ? 0 : 255;
+		colors[3 * i + 1] = 0;
+		colors[3 * i + 2] = fixed ? 255 : 0;
+	}
+
+	return changed;
+}
+
+/******************************************************************
+*
+* Upload
+*
+* Streams the positions (two floats each) and colors (three bytes
+* each) of all points into the vertex buffer and points the vertex
+* and color arrays at them; the buffer is reallocated on every
+* upload, so the driver need not wait for the previous frame to
+* finish with it
+*
+*******************************************************************/
+
+void SceneRenderer::Upload()
+{
+	const auto vertexBytes = points.size() * sizeof(float);
+
+	if (hasBuffers)
+	{
+		bindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+		bufferData(GL_ARRAY_BUFFER, vertexBytes + colors.size(), nullptr, GL_STREAM_DRAW);
+		bufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, points.data());
+		bufferSubData(GL_ARRAY_BUFFER, vertexBytes, colors.size(), colors.data());
+	}
+
+	/* Offsets into the buffer object, or the arrays themselves */
+	glVertexPointer(2, GL_FLOAT, 0, hasBuffers ? nullptr : points.data());
+	glColorPointer(3, GL_UNSIGNED_BYTE, 0, hasBuffers ? reinterpret_cast<const void*>(vertexBytes) : colors.data());
+}
+
+void SceneRenderer::Render(const SceneSnapshot& snapshot)
+{
+	if (mode == IMMEDIATE)
+	{
+		snapshot.Render();
+		return;
+	}
+
+	snapshot.RenderGround();
+
+	/* Spring indices stay in their buffer until the springs change */
+	if (Pack(snapshot) && hasBuffers)
+	{
+		bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+		bufferData(GL_ELEMENT_ARRAY_BUFFER, lines.size() * sizeof(GLuint), lines.data(), GL_STATIC_DRAW);
+		bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	if (points.empty())
+		return;
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+
+	Upload();
+
+	/* Render springs as gray lines between the points */
+	glColor3f(0.5, 0.5, 0.5);
+	glLineWidth(5);
+
+	if (!lines.empty())
+	{
+		if (hasBuffers)
+			bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+
+		glDrawElements(GL_LINES, (GLsizei)lines.size(), GL_UNSIGNED_INT, hasBuffers ? nullptr : lines.data());
+
+		if (hasBuffers)
+			bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	/* Mass points as round points of the drawn radius */
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glPointSize(max(1.0f, (float)(2.0 * snapshot.radius * viewport[2] / view_width)));
+	glEnable(GL_POINT_SMOOTH);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	glDrawArrays(GL_POINTS, 0, (GLsizei)(points.size() / 2));
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisable(GL_BLEND);
+	glDisable(GL_POINT_SMOOTH);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	if (hasBuffers)
+		bindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SceneRenderer::RenderPhases()
+{
+	const auto now = chrono::steady_clock::now();
+
+	if (overlay.empty() || chrono::duration<double>(now - refreshed).count() > overlay_refresh)
+	{
+		overlay.clear();
+		refreshed = now;
+
+#ifdef MASS_SPRING_TIMING
+		char line[128];
+
+		snprintf(line, sizeof(line), "%-10s %9s %9s %9s %10s", "phase", "min us", "p50 us", "p99 us", "count");
+		overlay.push_back(line);
+
+		for (int p = 0; p < NUM_PHASES; p++)
+		{
+			const auto s = SummarizePhase((Phase)p);
+
+			if (s.count == 0)
+				continue;
+
+			snprintf(line, sizeof(line), "%-10s %9.1f %9.1f %9.1f %10ld", GetPhaseName((Phase)p),
+			         s.min * 1e6, s.p50 * 1e6, s.p99 * 1e6, s.count);
+			overlay.push_back(line);
+		}
+#else
+		overlay.push_back("Phase timers disabled at compile time (MASS_SPRING_TIMING)");
+#endif
+	}
+
+	/* One line of the 13 pixel font per 15 pixels */
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	const auto pixel = view_width / max(1, viewport[3]);
+
+	glColor3f(1.0, 1.0, 1.0);
+
+	for (size_t k = 0; k < overlay.size(); k++)
+	{
+		glRasterPos2d(-view_width / 2 + 10 * pixel, view_width / 2 - (20 + 15 * k) * pixel);
+		glutBitmapString(GLUT_BITMAP_8_BY_13, (const unsigned char*)overlay[k].c_str());
+	}
+}
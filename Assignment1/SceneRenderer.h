@@ -0,0 +1,81 @@
+/******************************************************************
+*
+* SceneRenderer.h
+*
+* Description: Batched drawing of scene snapshots; all mass points
+* with their colors go into one vertex buffer, refilled every frame,
+* and the spring end points into an index buffer, refilled only when
+* the springs change; both are drawn with one call each (indexed
+* lines and round points)
+*
+* The buffers are OpenGL buffer objects if the driver has them, and
+* client-side arrays otherwise; the per-object drawing of
+* SceneSnapshot::Render remains available as immediate mode.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __SCENE_RENDERER_H__
+#define __SCENE_RENDERER_H__
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <GL/freeglut.h>
+
+#include "SceneSnapshot.h"
+
+class SceneRenderer
+{
+public:
+	enum Mode { BATCHED, IMMEDIATE };
+
+private:
+	Mode mode = BATCHED;
+
+	bool hasBuffers = false;  /* Buffer objects are supported */
+	GLuint buffers[2] = {};   /* Point positions and colors; spring end points */
+
+	/* Vertex data of the current frame, kept across frames */
+	vector<GLuint> lines;     /* Indices of both end points per spring */
+	vector<float> points;     /* x, y per point */
+	vector<uint8_t> colors;   /* r, g, b per point */
+	unsigned long topology = 0; /* SceneSnapshot::topology of lines */
+
+	/* Lines of the phase timer overlay, refreshed a few times per second */
+	vector<string> overlay;
+	chrono::steady_clock::time_point refreshed;
+
+	bool Pack(const SceneSnapshot& snapshot);
+	void Upload();
+
+public:
+	/* Needs the GL context; loads the buffer object functions */
+	void Init();
+
+	void Render(const SceneSnapshot& snapshot);
+
+	/* Min, median and 99th percentile of every timed phase as text in
+	   the upper left corner (PhaseTimers.h) */
+	void RenderPhases();
+
+	Mode GetMode() const
+	{
+		return mode;
+	}
+
+	void ToggleMode()
+	{
+		mode = mode == BATCHED ? IMMEDIATE : BATCHED;
+	}
+};
+
+#endif
@@ -0,0 +1,46 @@
+/******************************************************************
+*
+* SceneSnapshot.h
+*
+* Description: Copy of everything needed to draw a scene; written by
+* the simulation thread (Scene::Snapshot) and drawn by the display
+* callback, so drawing never touches the simulated state
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __SCENE_SNAPSHOT_H__
+#define __SCENE_SNAPSHOT_H__
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+struct SceneSnapshot
+{
+	vector<double> x, y;        /* Positions of mass points */
+	vector<uint64_t> fixedMask; /* As in ParticleSystem */
+	vector<int> ends;           /* End points of spring j at 2j and 2j + 1 */
+	unsigned long topology = 0; /* Version of ends, see Scene::Snapshot */
+
+	double time = 0.0;          /* Simulated time of the positions */
+	double radius = 0.0;        /* Drawn radius of mass points */
+	bool contacts = false;      /* Draw the ground line */
+	double ground = 0.0;
+
+	bool IsFixed(int i) const
+	{
+		return (fixedMask[i >> 6] >> (i & 63)) & 1u;
+	}
+
+	/* Per-object drawing (SceneRender.cpp); SceneRenderer draws in batches */
+	void Render() const;
+	void RenderGround() const;
+};
+
+#endif
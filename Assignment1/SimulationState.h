@@ -0,0 +1,136 @@
+/******************************************************************
+*
+* SimulationState.h
+*
+* Description: Per-scene bookkeeping of a running simulation -
+* simulated time, analytical reference points and their solution,
+* random numbers for the user force, contact handling and the
+* trajectory recorder; owned by the scene so several scenes can be
+* stepped side by side
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __SIMULATION_STATE_H__
+#define __SIMULATION_STATE_H__
+
+#include <cmath>
+#include <random>
+using namespace std;
+
+#include "ParticleSystem.h"
+#include "ImplicitEuler.h"
+#include "XpbdSolver.h"
+#include "ReferenceSolution.h"
+#include "ContactSolver.h"
+#include "TrajectoryRecorder.h"
+
+/* Running statistics of the RMS error against the analytical solution */
+struct ErrorStats
+{
+	long samples = 0;
+	double last = 0.0;
+	double max = 0.0;
+	double sum = 0.0;
+
+	void Add(double rms)
+	{
+		samples++;
+		last = rms;
+		sum += rms;
+
+		/* Keep NaN sticky, so diverged runs remain visible */
+		if (!(rms <= max))
+			max = rms;
+	}
+
+	double Mean() const
+	{
+		return samples > 0 ? sum / samples : 0.0;
+	}
+};
+
+/* Steps since last reset; fixed-step methods accept every step */
+struct StepStats
+{
+	long accepted = 0;
+	long rejected = 0;
+};
+
+/* Step size control of the adaptive integrator */
+struct StepControl
+{
+	double step = 0.0;          /* Proposed length of the next step */
+	double tolerance = 1e-4;    /* Absolute and relative error per step */
+	double error = 1.0;         /* Scaled error of the last accepted step */
+	bool fsal = false;          /* Last stage holds derivative at current state */
+};
+
+/* Comparison with the analytical reference every interval steps */
+struct ErrorSampling
+{
+	int interval = 1;
+	int phase = 0;              /* Steps since the last sample */
+	bool sampled = false;       /* Last step was compared */
+};
+
+struct SimulationState
+{
+	double time = 0.0;            /* Simulated time since last reset */
+
+	ParticleSystem reference;     /* Points following the analytical solution */
+	bool hasReference = false;    /* Reference is captured on first step */
+	bool analytical = true;       /* Scene has an analytical solution */
+	ReferenceSolution solution;   /* Constants of the closed form, set by Scene::Init */
+	ErrorSampling sampling;
+
+	default_random_engine rng;    /* Source of random user forces */
+
+	TrajectoryRecorder* recorder = nullptr; /* Receives every step, if set */
+	ErrorStats error;
+	StepStats steps;
+	StepControl control;
+
+	ContactSolver contacts;       /* Collision stage after every step, if enabled */
+	ImplicitSolver implicit;      /* Matrix and CG buffers, reused every step */
+	XpbdSolver xpbd;              /* Substeps and multipliers of XPBD */
+	vector<double> stage;         /* Saved per-point state of multi-stage methods */
+	vector<float> stageF32;       /* Same for scenes stepped in float */
+
+	template<class Real>
+	vector<Real>& GetStage();
+
+	void Reset()
+	{
+		time = 0.0;
+		hasReference = false;
+		reference.Clear();
+		solution.Reset();
+		sampling.phase = 0;
+		sampling.sampled = false;
+		error = ErrorStats();
+		steps = StepStats();
+
+		if (recorder)
+			recorder->NewRun();
+	}
+};
+
+template<>
+inline vector<double>& SimulationState::GetStage<double>()
+{
+	return stage;
+}
+
+template<>
+inline vector<float>& SimulationState::GetStage<float>()
+{
+	return stageF32;
+}
+
+#endif
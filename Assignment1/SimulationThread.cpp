@@ -0,0 +1,161 @@
+/******************************************************************
+*
+* SimulationThread.cpp
+*
+* Description: Simulation loop of the interactive application; the
+* timing of real-time mode is that of the former display callback,
+* measured by the simulation thread itself
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "SimulationThread.h"
+#include "PhaseTimers.h"
+
+/* Maximum time simulated per slice in real time (prevents performing
+   too many calculations when running slower than real time) */
+static constexpr double max_update_time = 0.01;
+
+/* Shortest slice in real time; the thread sleeps for the rest, so
+   steps are not split into tiny slices */
+static constexpr double min_update_time = 0.001;
+
+SimulationThread::SimulationThread(Scene& _scene, const int steps)
+	: scene(_scene), stepsPerSlice(steps), running(false)
+{
+	/* Something to draw before the first slice is done */
+	scene.Snapshot(snapshots.Back());
+	snapshots.Publish();
+}
+
+SimulationThread::~SimulationThread(void)
+{
+	Stop();
+}
+
+void SimulationThread::Start()
+{
+	if (running.exchange(true))
+		return;
+
+	worker = thread([this]() { Run(); });
+}
+
+void SimulationThread::Stop()
+{
+	running = false;
+
+	if (worker.joinable())
+		worker.join();
+}
+
+bool SimulationThread::Post(const SceneCommand& command)
+{
+	return commands.Push(command);
+}
+
+void SimulationThread::Apply(const SceneCommand& command)
+{
+	switch (command.type)
+	{
+		case SceneCommand::TOGGLE_FORCE:
+			scene.ToggleUserForce();
+			break;
+
+		case SceneCommand::TOGGLE_CONTACTS:
+			scene.ToggleContacts();
+			break;
+
+		case SceneCommand::MASS:
+			scene.increaseMass(command.value);
+			break;
+
+		case SceneCommand::STIFFNESS:
+			scene.increaseStiff(command.value);
+			break;
+
+		case SceneCommand::DAMPING:
+			scene.increaseDamp(command.value);
+			break;
+
+		case SceneCommand::STEP:
+			scene.increaseStep(command.value);
+			break;
+
+		case SceneCommand::RESET:
+			scene.resetInitial();
+			break;
+
+		case SceneCommand::CHECKPOINT:
+			scene.SaveCheckpoint(scene.GetCheckpointFile());
+			cerr << "Checkpoint at t = " << scene.GetTime() << endl;
+			break;
+
+		case SceneCommand::RESTORE:
+			if (scene.RestoreCheckpoint(scene.GetCheckpointFile()))
+				scene.PrintSettings();
+			break;
+	}
+}
+
+/******************************************************************
+*
+* Run
+*
+* Applies queued commands, simulates one slice and publishes its
+* snapshot until stopped; a slice is either a fixed number of steps
+* or the time passed since the previous slice, of which fixed-step
+* methods carry the remainder below one step over; periodic
+* checkpoints are taken between slices
+*
+*******************************************************************/
+
+void SimulationThread::Run()
+{
+	using clock = chrono::steady_clock;
+
+	auto previous = clock::now();
+	auto remaining = 0.0;
+
+	while (running.load(memory_order_relaxed))
+	{
+		SceneCommand command;
+
+		while (commands.Pop(command))
+			Apply(command);
+
+		if (stepsPerSlice > 0)
+		{
+			for (int i = 0; i < stepsPerSlice; i++)
+				scene.Update();
+		}
+		else
+		{
+			this_thread::sleep_until(previous + chrono::duration<double>(min_update_time));
+
+			const auto now = clock::now();
+			const auto passed = min(chrono::duration<double>(now - previous).count(), max_update_time);
+
+			remaining = scene.Advance(passed + remaining);
+			previous = now;
+		}
+
+		scene.AutoSave();
+
+		{
+			ScopedPhaseTimer timer(PHASE_SNAPSHOT);
+			scene.Snapshot(snapshots.Back());
+		}
+
+		snapshots.Publish();
+	}
+}
@@ -0,0 +1,77 @@
+/******************************************************************
+*
+* SimulationThread.h
+*
+* Description: Runs the time steps of a scene on a thread of its
+* own, so the simulation neither waits for drawing nor stalls it
+*
+* The thread owns the scene while it runs. Changes of the scene are
+* posted as commands and applied between steps; after every slice of
+* steps the thread publishes a snapshot for drawing. Both hand-overs
+* are lock-free, so neither thread ever waits on the other.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __SIMULATION_THREAD_H__
+#define __SIMULATION_THREAD_H__
+
+#include <atomic>
+#include <thread>
+using namespace std;
+
+#include "Scene.h"
+#include "SceneSnapshot.h"
+#include "TripleBuffer.h"
+#include "CommandQueue.h"
+
+/* Change of the scene requested by the user */
+struct SceneCommand
+{
+	enum Type { TOGGLE_FORCE, TOGGLE_CONTACTS, MASS, STIFFNESS, DAMPING, STEP, RESET,
+	            CHECKPOINT, RESTORE };
+
+	Type type;
+	double value; /* Increment of MASS, STIFFNESS, DAMPING and STEP */
+};
+
+class SimulationThread
+{
+private:
+	Scene& scene;
+	int stepsPerSlice;            /* 0 runs in real time */
+
+	thread worker;
+	atomic<bool> running;
+
+	TripleBuffer<SceneSnapshot> snapshots;
+	CommandQueue<SceneCommand, 64> commands;
+
+	void Run();
+	void Apply(const SceneCommand& command);
+
+public:
+	/* Fixed number of steps between snapshots, as fast as possible,
+	   or steps of simulated time as it passes if steps is 0 */
+	SimulationThread(Scene& _scene, int steps);
+	~SimulationThread(void);
+
+	void Start();
+	void Stop(); /* Returns after the current slice */
+
+	/* Queue a change; false if the queue is full */
+	bool Post(const SceneCommand& command);
+
+	/* Latest snapshot; valid until the next call */
+	const SceneSnapshot& GetSnapshot()
+	{
+		return snapshots.Front();
+	}
+};
+
+#endif
@@ -13,53 +13,25 @@
 *******************************************************************/
 
 #include "Spring.h"
-#include <GL/freeglut.h>
 
-void Spring::init(Point* _p0, Point* _p1)
+template<class Real>
+void BasicSpring<Real>::init(int _p0, int _p1, const BasicParticleSystem<Real>& particles)
 {
-	/* Initialize spring with pointers to both mass points */
-	p0 = _p0;
-	p1 = _p1;
+	/* Initialize spring with indices of both mass points */
+	p0 = (uint32_t)_p0;
+	p1 = (uint32_t)_p1;
 
 	/* Assume rest length is given by initial configuration */
-	restLength = (p0->getPos() - p1->getPos()).length();
+	restLength = (particles.GetPos(_p0) - particles.GetPos(_p1)).length();
 }
 
-void Spring::render()
+template<class Real>
+void BasicSpring<Real>::init(int _p0, int _p1, double L)
 {
-	/* Render spring as gray line */
-	glColor3f(0.5, 0.5, 0.5);
-	glLineWidth(5);
-	glBegin(GL_LINES);
-	glVertex3d(p0->getX(), p0->getY(), 0.0);
-	glVertex3d(p1->getX(), p1->getY(), 0.0);
-	glEnd();
+	p0 = (uint32_t)_p0;
+	p1 = (uint32_t)_p1;
+	restLength = (Real)L;
 }
 
-void Spring::setRestLength(double L)
-{
-	restLength = L;
-}
-
-double Spring::getRestLength() const
-{
-	return restLength;
-}
-
-void Spring::setStiffness(double k)
-{
-	stiffness = k;
-}
-
-double Spring::getStiffness() const
-{
-	return stiffness;
-}
-
-Point* Spring::getPoint(int i) const
-{
-	/* Return point 1 or 0 (assume i = 0,1) */
-	if (i)
-		return p1;
-	return p0;
-}
+template class BasicSpring<double>;
+template class BasicSpring<float>;
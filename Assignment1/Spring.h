@@ -15,45 +15,87 @@
 #ifndef __SPRING_H__
 #define __SPRING_H__
 
-#include "Point.h"
+#include <cstdint>
+using namespace std;
 
-class Spring
+#include "ParticleSystem.h"
+
+/* Plain record of end point indices and material; springs can be
+   copied, reordered and written to files as they are */
+template<class Real>
+class BasicSpring
 {
 private:
-    Point *p0, *p1;      /* Pointer to two end points */
-    double stiffness;
-    double restLength;   /* Rest length of spring (does not have to be initial length) */
+    uint32_t p0, p1;     /* Indices of the two end points */
+    Real stiffness;
+    Real restLength;     /* Rest length of spring (does not have to be initial length) */
 
 public:                  /* Various constructors */ 
-    Spring(void)
+    BasicSpring(void)
     {
-        p0 = new Point;
-        p1 = new Point;
+        p0 = 0;
+        p1 = 0;
         stiffness = 0.0;
         restLength = 0.0;
     }
  
-    Spring(double k)
+    BasicSpring(double k)
     {
-        p0 = new Point;
-        p1 = new Point;
-        stiffness = k;
+        p0 = 0;
+        p1 = 0;
+        stiffness = (Real)k;
         restLength = 0.0;
     }
 
-    ~Spring(void){}
-	
-    void init(Point *_p0, Point *_p1);
-    void render();
+    /* Same spring in another scalar type */
+    template<class Other>
+    explicit BasicSpring(const BasicSpring<Other>& s)
+    {
+        p0 = (uint32_t)s.getPoint(0);
+        p1 = (uint32_t)s.getPoint(1);
+        stiffness = (Real)s.getStiffness();
+        restLength = (Real)s.getRestLength();
+    }
+
+    void init(int _p0, int _p1, const BasicParticleSystem<Real>& particles);
+    void init(int _p0, int _p1, double L); /* Explicit rest length */
+
+    /* Accessors are inline, force and solver loops read them per step */
+    void setRestLength(double L)
+    {
+        restLength = (Real)L;
+    }
+
+    Real getRestLength() const
+    {
+        return restLength;
+    }
 
-    void setRestLength(double L);
-    double getRestLength() const;
+    void setStiffness(double k)
+    {
+        stiffness = (Real)k;
+    }
 
-    void setStiffness(double k);
-    double getStiffness() const;
+    Real getStiffness() const
+    {
+        return stiffness;
+    }
 
-    Point *getPoint(int i) const;     /* Return end point 0 or 1 */
+    /* Return index of end point 0 or 1 */
+    int getPoint(int i) const
+    {
+        return (int)(i ? p1 : p0);
+    }
 };
 
-#endif
+extern template class BasicSpring<double>;
+extern template class BasicSpring<float>;
+
+typedef BasicSpring<double> Spring;
+typedef BasicSpring<float> SpringF32;
 
+/* Two scalars and two 32-bit indices, no padding */
+static_assert(sizeof(Spring) == 24, "Spring record is not packed");
+static_assert(sizeof(SpringF32) == 16, "Spring record is not packed");
+
+#endif
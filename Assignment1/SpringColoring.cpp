@@ -0,0 +1,124 @@
+/******************************************************************
+*
+* SpringColoring.cpp
+*
+* Description: Greedy edge coloring of the spring graph; every spring
+* takes the lowest color not yet used at either end point, which is
+* linear in the number of springs
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <cstdint>
+
+#include "SpringColoring.h"
+
+template<class Real>
+void BasicSpringColoring<Real>::Build(const int numPoints, const vector<BasicSpring<Real>>& springs)
+{
+	const auto numSprings = (int)springs.size();
+
+	/* Colors already used at a point, one bit per color */
+	vector<uint64_t> used(numPoints, 0);
+	vector<int> color(numSprings);
+
+	auto numColors = 0;
+	overflow = false;
+
+	for (int s = 0; s < numSprings; s++)
+	{
+		const auto i0 = springs[s].getPoint(0);
+		const auto i1 = springs[s].getPoint(1);
+
+		const auto free = ~(used[i0] | used[i1]);
+
+		auto c = MaxColors;
+
+		if (free != 0)
+		{
+			c = 0;
+			while (!((free >> c) & 1u))
+				c++;
+
+			used[i0] |= uint64_t(1) << c;
+			used[i1] |= uint64_t(1) << c;
+		}
+		else
+		{
+			overflow = true;
+		}
+
+		color[s] = c;
+
+		if (c < MaxColors && c + 1 > numColors)
+			numColors = c + 1;
+	}
+
+	/* Overflow springs are appended as one extra, serial color */
+	const auto totalColors = numColors + (overflow ? 1 : 0);
+
+	offsets.assign(totalColors + 1, 0);
+
+	for (int s = 0; s < numSprings; s++)
+	{
+		const auto c = color[s] < MaxColors ? color[s] : numColors;
+		offsets[c + 1]++;
+	}
+
+	for (int c = 0; c < totalColors; c++)
+		offsets[c + 1] += offsets[c];
+
+	/* Stable counting sort keeps springs in input order within a color */
+	order.resize(numSprings);
+
+	vector<int> fill(offsets.begin(), offsets.end() - 1);
+
+	for (int s = 0; s < numSprings; s++)
+	{
+		const auto c = color[s] < MaxColors ? color[s] : numColors;
+		order[fill[c]++] = s;
+	}
+
+	Gather(springs);
+}
+
+template<class Real>
+void BasicSpringColoring<Real>::Gather(const vector<BasicSpring<Real>>& springs)
+{
+	const auto numSprings = (int)order.size();
+
+	i0.resize(numSprings);
+	i1.resize(numSprings);
+	stiffness.resize(numSprings);
+	restLength.resize(numSprings);
+
+	for (int j = 0; j < numSprings; j++)
+	{
+		const auto& spring = springs[order[j]];
+
+		i0[j] = spring.getPoint(0);
+		i1[j] = spring.getPoint(1);
+		stiffness[j] = spring.getStiffness();
+		restLength[j] = spring.getRestLength();
+	}
+}
+
+template<class Real>
+void BasicSpringColoring<Real>::Clear()
+{
+	offsets.clear();
+	order.clear();
+	i0.clear();
+	i1.clear();
+	stiffness.clear();
+	restLength.clear();
+	overflow = false;
+}
+
+template class BasicSpringColoring<double>;
+template class BasicSpringColoring<float>;
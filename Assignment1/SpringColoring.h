@@ -0,0 +1,90 @@
+/******************************************************************
+*
+* SpringColoring.h
+*
+* Description: Partition of the springs into colors such that no two
+* springs of one color share an end point; springs of a color can
+* therefore scatter their forces to both end points concurrently
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __SPRING_COLORING_H__
+#define __SPRING_COLORING_H__
+
+#include <vector>
+using namespace std;
+
+#include "Spring.h"
+
+template<class Real>
+class BasicSpringColoring
+{
+private:
+	vector<int> offsets; /* Per color start into order, size colors+1 */
+	vector<int> order;   /* Spring indices grouped by color */
+	bool overflow = false; /* Last color may contain conflicts */
+
+public:
+	/* Spring data in color order, for vectorized force kernels */
+	vector<int> i0, i1;
+	vector<Real> stiffness;
+	vector<Real> restLength;
+
+	/* Upper bound of conflict-free colors; springs beyond go into
+	   one trailing color that has to be processed serially */
+	static constexpr int MaxColors = 64;
+
+	void Build(int numPoints, const vector<BasicSpring<Real>>& springs);
+
+	/* Copy spring data into color order again, after the material of
+	   the springs changed; the colors stay */
+	void Gather(const vector<BasicSpring<Real>>& springs);
+	void Clear();
+
+	int GetNumColors() const
+	{
+		return offsets.empty() ? 0 : (int)offsets.size() - 1;
+	}
+
+	/* True, if springs of color c may share end points */
+	bool IsSerial(int c) const
+	{
+		return overflow && c == GetNumColors() - 1;
+	}
+
+	/* Position of color c in the color ordered arrays as [first, last) */
+	int First(int c) const
+	{
+		return offsets[c];
+	}
+
+	int Last(int c) const
+	{
+		return offsets[c + 1];
+	}
+
+	/* Springs of color c as [begin, end) range */
+	const int* begin(int c) const
+	{
+		return order.data() + offsets[c];
+	}
+
+	const int* end(int c) const
+	{
+		return order.data() + offsets[c + 1];
+	}
+};
+
+extern template class BasicSpringColoring<double>;
+extern template class BasicSpringColoring<float>;
+
+typedef BasicSpringColoring<double> SpringColoring;
+typedef BasicSpringColoring<float> SpringColoringF32;
+
+#endif
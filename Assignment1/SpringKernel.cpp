@@ -0,0 +1,394 @@
+/******************************************************************
+*
+* SpringKernel.cpp
+*
+* Description: Scalar and SIMD implementations of the spring force
+* kernel and run-time CPU dispatch
+*
+* The AVX2 kernel uses one sqrt and one division per lane; the
+* AVX-512 kernel uses rsqrt14 refined by two Newton steps, which is
+* accurate to double precision and needs neither sqrt nor division.
+* The float variants need one Newton step for single precision.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <cmath>
+
+#include "SpringKernel.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SPRING_KERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/* MSVC accepts AVX intrinsics in any function; GCC and Clang need
+   the target enabled per function */
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+/* Springs shorter than this exert no force (direction undefined) */
+static constexpr double tiny_distance = 0.00000001;
+
+template<class Real>
+static void AddSpringForcesScalar(BasicParticleSystem<Real>& particles,
+                                  const BasicSpringColoring<Real>& springs,
+                                  const int first, const int last)
+{
+	auto x = particles.x.data();
+	auto y = particles.y.data();
+	auto fx = particles.fx.data();
+	auto fy = particles.fy.data();
+
+	for (int j = first; j < last; j++)
+	{
+		const auto i0 = springs.i0[j];
+		const auto i1 = springs.i1[j];
+
+		const auto dx = x[i0] - x[i1];
+		const auto dy = y[i0] - y[i1];
+
+		const auto distance = std::sqrt(dx * dx + dy * dy);
+
+		if (distance < (Real)tiny_distance)
+			continue;
+
+		const auto scale = springs.stiffness[j] *
+			(springs.restLength[j] - distance) / distance;
+
+		fx[i0] += scale * dx;
+		fy[i0] += scale * dy;
+		fx[i1] -= scale * dx;
+		fy[i1] -= scale * dy;
+	}
+}
+
+#ifdef SPRING_KERNEL_X86
+
+/* Gathers (and rsqrt14 below) with explicit zero source; the unmasked
+   intrinsics start from an undefined register, which GCC reports as
+   uninitialized */
+TARGET_AVX2
+static inline __m256d Gather4(const double* base, const __m128i idx)
+{
+	return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, idx,
+	                                 _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+
+TARGET_AVX2
+static inline __m256 Gather8(const float* base, const __m256i idx)
+{
+	return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, idx,
+	                                _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4);
+}
+
+TARGET_AVX512
+static inline __m512d Gather8(const double* base, const __m256i idx)
+{
+	return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xff, idx, base, 8);
+}
+
+TARGET_AVX512
+static inline __m512 Gather16(const float* base, const __m512i idx)
+{
+	return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xffff, idx, base, 4);
+}
+
+TARGET_AVX2
+static void AddSpringForcesAVX2(ParticleSystem& particles,
+                                const SpringColoring& springs,
+                                const int first, const int last)
+{
+	auto x = particles.x.data();
+	auto y = particles.y.data();
+	auto fx = particles.fx.data();
+	auto fy = particles.fy.data();
+
+	const auto tiny = _mm256_set1_pd(tiny_distance);
+
+	alignas(32) double sx[4], sy[4];
+
+	auto j = first;
+
+	for (; j + 4 <= last; j += 4)
+	{
+		const auto idx0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&springs.i0[j]));
+		const auto idx1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&springs.i1[j]));
+
+		const auto dx = _mm256_sub_pd(Gather4(x, idx0), Gather4(x, idx1));
+		const auto dy = _mm256_sub_pd(Gather4(y, idx0), Gather4(y, idx1));
+
+		const auto distance = _mm256_sqrt_pd(
+			_mm256_fmadd_pd(dx, dx, _mm256_mul_pd(dy, dy)));
+
+		/* Division by zero in masked lanes yields inf/NaN, cleared below */
+		auto scale = _mm256_div_pd(
+			_mm256_mul_pd(_mm256_loadu_pd(&springs.stiffness[j]),
+			              _mm256_sub_pd(_mm256_loadu_pd(&springs.restLength[j]), distance)),
+			distance);
+
+		scale = _mm256_and_pd(scale, _mm256_cmp_pd(distance, tiny, _CMP_GE_OQ));
+
+		_mm256_store_pd(sx, _mm256_mul_pd(scale, dx));
+		_mm256_store_pd(sy, _mm256_mul_pd(scale, dy));
+
+		/* No scatter in AVX2; lanes are conflict-free within a color */
+		for (int l = 0; l < 4; l++)
+		{
+			const auto i0 = springs.i0[j + l];
+			const auto i1 = springs.i1[j + l];
+
+			fx[i0] += sx[l];
+			fy[i0] += sy[l];
+			fx[i1] -= sx[l];
+			fy[i1] -= sy[l];
+		}
+	}
+
+	AddSpringForcesScalar(particles, springs, j, last);
+}
+
+TARGET_AVX2
+static void AddSpringForcesAVX2(ParticleSystemF32& particles,
+                                const SpringColoringF32& springs,
+                                const int first, const int last)
+{
+	auto x = particles.x.data();
+	auto y = particles.y.data();
+	auto fx = particles.fx.data();
+	auto fy = particles.fy.data();
+
+	const auto tiny = _mm256_set1_ps((float)tiny_distance);
+
+	alignas(32) float sx[8], sy[8];
+
+	auto j = first;
+
+	for (; j + 8 <= last; j += 8)
+	{
+		const auto idx0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&springs.i0[j]));
+		const auto idx1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&springs.i1[j]));
+
+		const auto dx = _mm256_sub_ps(Gather8(x, idx0), Gather8(x, idx1));
+		const auto dy = _mm256_sub_ps(Gather8(y, idx0), Gather8(y, idx1));
+
+		const auto distance = _mm256_sqrt_ps(
+			_mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy)));
+
+		auto scale = _mm256_div_ps(
+			_mm256_mul_ps(_mm256_loadu_ps(&springs.stiffness[j]),
+			              _mm256_sub_ps(_mm256_loadu_ps(&springs.restLength[j]), distance)),
+			distance);
+
+		scale = _mm256_and_ps(scale, _mm256_cmp_ps(distance, tiny, _CMP_GE_OQ));
+
+		_mm256_store_ps(sx, _mm256_mul_ps(scale, dx));
+		_mm256_store_ps(sy, _mm256_mul_ps(scale, dy));
+
+		for (int l = 0; l < 8; l++)
+		{
+			const auto i0 = springs.i0[j + l];
+			const auto i1 = springs.i1[j + l];
+
+			fx[i0] += sx[l];
+			fy[i0] += sy[l];
+			fx[i1] -= sx[l];
+			fy[i1] -= sy[l];
+		}
+	}
+
+	AddSpringForcesScalar(particles, springs, j, last);
+}
+
+TARGET_AVX512
+static void AddSpringForcesAVX512(ParticleSystem& particles,
+                                  const SpringColoring& springs,
+                                  const int first, const int last)
+{
+	auto x = particles.x.data();
+	auto y = particles.y.data();
+	auto fx = particles.fx.data();
+	auto fy = particles.fy.data();
+
+	const auto tiny2 = _mm512_set1_pd(tiny_distance * tiny_distance);
+	const auto half = _mm512_set1_pd(0.5);
+	const auto threeHalves = _mm512_set1_pd(1.5);
+	const auto one = _mm512_set1_pd(1.0);
+
+	auto j = first;
+
+	for (; j + 8 <= last; j += 8)
+	{
+		const auto idx0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&springs.i0[j]));
+		const auto idx1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&springs.i1[j]));
+
+		const auto dx = _mm512_sub_pd(Gather8(x, idx0), Gather8(x, idx1));
+		const auto dy = _mm512_sub_pd(Gather8(y, idx0), Gather8(y, idx1));
+
+		const auto d2 = _mm512_fmadd_pd(dx, dx, _mm512_mul_pd(dy, dy));
+
+		/* 1 / |d| from 14 bit estimate, two Newton steps to full precision */
+		auto inv = _mm512_maskz_rsqrt14_pd(0xff, d2);
+		const auto halfD2 = _mm512_mul_pd(half, d2);
+		inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(halfD2, _mm512_mul_pd(inv, inv), threeHalves));
+		inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(halfD2, _mm512_mul_pd(inv, inv), threeHalves));
+
+		/* k (L - |d|) / |d| = k (L / |d| - 1), zero for tiny springs */
+		const auto valid = _mm512_cmp_pd_mask(d2, tiny2, _CMP_GE_OQ);
+		const auto scale = _mm512_maskz_mul_pd(valid,
+			_mm512_loadu_pd(&springs.stiffness[j]),
+			_mm512_fmsub_pd(_mm512_loadu_pd(&springs.restLength[j]), inv, one));
+
+		const auto sx = _mm512_mul_pd(scale, dx);
+		const auto sy = _mm512_mul_pd(scale, dy);
+
+		/* Indices are unique within a color, so gather-add-scatter is safe */
+		_mm512_i32scatter_pd(fx, idx0, _mm512_add_pd(Gather8(fx, idx0), sx), 8);
+		_mm512_i32scatter_pd(fy, idx0, _mm512_add_pd(Gather8(fy, idx0), sy), 8);
+		_mm512_i32scatter_pd(fx, idx1, _mm512_sub_pd(Gather8(fx, idx1), sx), 8);
+		_mm512_i32scatter_pd(fy, idx1, _mm512_sub_pd(Gather8(fy, idx1), sy), 8);
+	}
+
+	AddSpringForcesScalar(particles, springs, j, last);
+}
+
+TARGET_AVX512
+static void AddSpringForcesAVX512(ParticleSystemF32& particles,
+                                  const SpringColoringF32& springs,
+                                  const int first, const int last)
+{
+	auto x = particles.x.data();
+	auto y = particles.y.data();
+	auto fx = particles.fx.data();
+	auto fy = particles.fy.data();
+
+	const auto tiny2 = _mm512_set1_ps((float)(tiny_distance * tiny_distance));
+	const auto half = _mm512_set1_ps(0.5f);
+	const auto threeHalves = _mm512_set1_ps(1.5f);
+	const auto one = _mm512_set1_ps(1.0f);
+
+	auto j = first;
+
+	for (; j + 16 <= last; j += 16)
+	{
+		const auto idx0 = _mm512_loadu_si512(&springs.i0[j]);
+		const auto idx1 = _mm512_loadu_si512(&springs.i1[j]);
+
+		const auto dx = _mm512_sub_ps(Gather16(x, idx0), Gather16(x, idx1));
+		const auto dy = _mm512_sub_ps(Gather16(y, idx0), Gather16(y, idx1));
+
+		const auto d2 = _mm512_fmadd_ps(dx, dx, _mm512_mul_ps(dy, dy));
+
+		/* 14 bit estimate, one Newton step covers the float mantissa */
+		auto inv = _mm512_maskz_rsqrt14_ps(0xffff, d2);
+		const auto halfD2 = _mm512_mul_ps(half, d2);
+		inv = _mm512_mul_ps(inv, _mm512_fnmadd_ps(halfD2, _mm512_mul_ps(inv, inv), threeHalves));
+
+		const auto valid = _mm512_cmp_ps_mask(d2, tiny2, _CMP_GE_OQ);
+		const auto scale = _mm512_maskz_mul_ps(valid,
+			_mm512_loadu_ps(&springs.stiffness[j]),
+			_mm512_fmsub_ps(_mm512_loadu_ps(&springs.restLength[j]), inv, one));
+
+		const auto sx = _mm512_mul_ps(scale, dx);
+		const auto sy = _mm512_mul_ps(scale, dy);
+
+		_mm512_i32scatter_ps(fx, idx0, _mm512_add_ps(Gather16(fx, idx0), sx), 4);
+		_mm512_i32scatter_ps(fy, idx0, _mm512_add_ps(Gather16(fy, idx0), sy), 4);
+		_mm512_i32scatter_ps(fx, idx1, _mm512_sub_ps(Gather16(fx, idx1), sx), 4);
+		_mm512_i32scatter_ps(fy, idx1, _mm512_sub_ps(Gather16(fy, idx1), sy), 4);
+	}
+
+	AddSpringForcesScalar(particles, springs, j, last);
+}
+
+#endif
+
+bool IsSpringKernelSupported(const SpringKernelType type)
+{
+	if (type == KERNEL_SCALAR)
+		return true;
+
+#if defined(SPRING_KERNEL_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+
+	if (type == KERNEL_AVX2)
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+	return __builtin_cpu_supports("avx512f");
+#elif defined(SPRING_KERNEL_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, 1, 0);
+
+	const auto osxsave = (info[2] & (1 << 27)) != 0;
+	const auto fma = (info[2] & (1 << 12)) != 0;
+
+	if (!osxsave)
+		return false;
+
+	/* Operating system must save YMM (and ZMM) registers */
+	const auto xcr0 = _xgetbv(0);
+
+	__cpuidex(info, 7, 0);
+
+	if (type == KERNEL_AVX2)
+		return fma && (info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6;
+
+	return (info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6;
+#else
+	return false;
+#endif
+}
+
+SpringKernelType GetBestSpringKernel()
+{
+	if (IsSpringKernelSupported(KERNEL_AVX512))
+		return KERNEL_AVX512;
+
+	if (IsSpringKernelSupported(KERNEL_AVX2))
+		return KERNEL_AVX2;
+
+	return KERNEL_SCALAR;
+}
+
+template<class Real>
+BasicSpringForceKernel<Real> GetSpringKernel(const SpringKernelType type)
+{
+#ifdef SPRING_KERNEL_X86
+	switch (type)
+	{
+		case KERNEL_AVX2:
+			return AddSpringForcesAVX2;
+
+		case KERNEL_AVX512:
+			return AddSpringForcesAVX512;
+
+		default:
+			break;
+	}
+#endif
+
+	return AddSpringForcesScalar<Real>;
+}
+
+template SpringForceKernel GetSpringKernel<double>(SpringKernelType);
+template SpringForceKernelF32 GetSpringKernel<float>(SpringKernelType);
+
+const char* GetSpringKernelName(const SpringKernelType type)
+{
+	static const char* const names[] = { "scalar", "avx2", "avx512" };
+
+	return names[type];
+}
@@ -0,0 +1,51 @@
+/******************************************************************
+*
+* SpringKernel.h
+*
+* Description: Spring force kernels over the color ordered spring
+* arrays; a scalar reference version plus AVX2 (4 springs) and
+* AVX-512 (8 springs per instruction) variants, selected at run time
+* from the capabilities of the CPU
+*
+* Every kernel exists for double and float points; the float vector
+* kernels process twice as many springs per instruction.
+*
+* A kernel adds k (L - |d|) d / |d|, d = x0 - x1, to the force of end
+* point 0 and subtracts it from end point 1; springs shorter than
+* 1e-8 are skipped. Within one color no two springs share an end
+* point, so the vector kernels may gather and scatter forces freely.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __SPRING_KERNEL_H__
+#define __SPRING_KERNEL_H__
+
+#include "ParticleSystem.h"
+#include "SpringColoring.h"
+
+enum SpringKernelType { KERNEL_SCALAR, KERNEL_AVX2, KERNEL_AVX512 };
+
+/* Adds the forces of springs [first, last) in color order */
+template<class Real>
+using BasicSpringForceKernel = void (*)(BasicParticleSystem<Real>& particles,
+                                        const BasicSpringColoring<Real>& springs,
+                                        int first, int last);
+
+typedef BasicSpringForceKernel<double> SpringForceKernel;
+typedef BasicSpringForceKernel<float> SpringForceKernelF32;
+
+bool IsSpringKernelSupported(SpringKernelType type);
+SpringKernelType GetBestSpringKernel();
+
+/* Instantiated for double and float */
+template<class Real = double>
+BasicSpringForceKernel<Real> GetSpringKernel(SpringKernelType type);
+const char* GetSpringKernelName(SpringKernelType type);
+
+#endif
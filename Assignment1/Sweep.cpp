@@ -0,0 +1,582 @@
+/******************************************************************
+*
+* Sweep.cpp
+*
+* Description: Headless parameter sweep over the mass-spring test
+* cases; every combination of method, stiffness, step size, damping
+* and mass is simulated for a fixed simulated duration on a pool of
+* worker threads, and one row per configuration is written to a
+* single result table (";"-separated like the logs in results/)
+*
+* With -ensemble, consecutive configurations of one explicit method
+* are stepped together as an Ensemble, which shares every loop over
+* points and springs among the batch; the results are identical to
+* single runs, the wall time of a batch is split evenly among its
+* configurations.
+*
+* With -precision float, the configurations run in float state
+* instead: explicit fixed-step methods as float ensembles, all others
+* as scenes stepped in float (Scene -precision). -precision compare
+* runs every configuration in both and appends the float errors and
+* their ratio to the double errors to each row, followed by a summary
+* per method on stderr.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+/* Standard includes */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/* Local includes */
+#include "Scene.h"
+#include "Ensemble.h"
+
+struct Configuration
+{
+	Scene::Method method;
+	double stiffness;
+	double step;
+	double damping;
+	double mass;
+};
+
+/* Scalar type of the simulated state */
+enum Precision
+{
+	DOUBLE, FLOAT, COMPARE
+};
+
+struct Result
+{
+	long steps;     /* Accepted steps */
+	long rejected;  /* Rejected steps of the adaptive method */
+	double time;
+	ErrorStats error;
+	double wallSeconds;
+	bool diverged;
+};
+
+/******************************************************************
+*
+* ParseRange
+*
+* Expands "start[:stop[:increment]]" into the list of values; the
+* stop value is inclusive
+*
+*******************************************************************/
+
+static vector<double> ParseRange(const char* text)
+{
+	double start = 0.0, stop = 0.0, inc = 0.0;
+
+	const auto fields = sscanf(text, "%lf:%lf:%lf", &start, &stop, &inc);
+
+	if (fields < 1)
+	{
+		cerr << "Invalid range: " << text << endl;
+		exit(1);
+	}
+
+	if (fields == 1)
+		return { start };
+
+	if (fields == 2 || inc <= 0.0)
+		return { start, stop };
+
+	vector<double> values;
+
+	/* Index based, so rounding does not accumulate over the range */
+	for (long k = 0; start + k * inc <= stop + 1e-9 * inc; k++)
+		values.push_back(start + k * inc);
+
+	return values;
+}
+
+static vector<Scene::Method> ParseMethods(const char* text)
+{
+	vector<Scene::Method> methods;
+
+	string list(text);
+	size_t begin = 0;
+
+	while (begin <= list.size())
+	{
+		auto end = list.find(',', begin);
+
+		if (end == string::npos)
+			end = list.size();
+
+		const auto name = list.substr(begin, end - begin);
+
+		Scene::Method method;
+
+		if (!Scene::ParseMethod(name.c_str(), method))
+		{
+			cerr << "Unrecognized method: " << name << endl;
+			exit(1);
+		}
+
+		methods.push_back(method);
+		begin = end + 1;
+	}
+
+	return methods;
+}
+
+static bool ParsePrecision(const char* text, Precision& precision)
+{
+	if (!strcmp(text, "double"))
+		precision = DOUBLE;
+	else if (!strcmp(text, "float"))
+		precision = FLOAT;
+	else if (!strcmp(text, "compare"))
+		precision = COMPARE;
+	else
+		return false;
+
+	return true;
+}
+
+static void PrintUsage()
+{
+	cerr << "Usage: ./MassSpringSweep -[option1] [setting1] -[option2] [setting2] ..." << endl;
+	cerr << "Ranges are given as start[:stop[:increment]]" << endl;
+	cerr << "Options:" << endl;
+	cerr << "\t-testcase [spring1D, hanging, falling]" << endl;
+	cerr << "\t-method [comma separated list of methods]" << endl;
+	cerr << "\t-stepping [inplace, twophase]" << endl;
+	cerr << "\t-stiff [range]" << endl;
+	cerr << "\t-step [range]" << endl;
+	cerr << "\t-damp [range]" << endl;
+	cerr << "\t-mass [range]" << endl;
+	cerr << "\t-duration [simulated seconds]" << endl;
+	cerr << "\t-tol [error tolerance of adaptive, step is its initial step]" << endl;
+	cerr << "\t-sample [steps between comparisons with the analytical solution]" << endl;
+	cerr << "\t-threads [worker threads, 0 = all cores]" << endl;
+	cerr << "\t-ensemble [configurations per batch of explicit methods, 0 = off]" << endl;
+	cerr << "\t-precision [double, float, compare]" << endl;
+	cerr << "\t-out [result table, default stdout]" << endl;
+	cerr << "\t-series [directory for per-run trajectories, off by default]" << endl << endl;
+}
+
+/* Error series of a configuration, named like the files in results/;
+   TrajectoryDump converts them to the ";"-separated text */
+static string SeriesName(const char* seriesDir, const Configuration& config)
+{
+	ostringstream name;
+	name << seriesDir << "/" << Scene::GetMethodName(config.method)
+	     << config.stiffness << "_" << config.step << ".traj";
+
+	return name.str();
+}
+
+static Result Run(const Configuration& config, Scene::Testcase testcase,
+                  Scene::Stepping stepping, Scene::Precision precision,
+                  double duration, double tolerance, int sample, const char* seriesDir)
+{
+	const auto start = chrono::steady_clock::now();
+
+	Scene scene(config.method, testcase, config.step,
+	            config.mass, config.stiffness, config.damping);
+
+	scene.SetStepping(stepping);
+	scene.SetPrecision(precision);
+	scene.SetTolerance(tolerance);
+	scene.SetErrorInterval(sample);
+
+	/* Optional error series */
+	if (seriesDir)
+		scene.Record(SeriesName(seriesDir, config).c_str(), false);
+
+	Result result = {};
+
+	/* Fixed-step methods take duration / step steps, adaptive
+	   methods shorten their last step to end exactly after duration */
+	const auto adaptive = Scene::IsAdaptive(config.method);
+	const auto steps = (long)llround(duration / config.step);
+
+	auto left = duration;
+
+	for (long i = 0; adaptive ? left > 0.0 : i < steps; i++)
+	{
+		left -= scene.Update(left);
+
+		/* Stop simulating configurations that blew up */
+		if (!isfinite(scene.GetError().last))
+		{
+			result.diverged = true;
+			break;
+		}
+	}
+
+	result.steps = scene.GetStepStats().accepted;
+	result.rejected = scene.GetStepStats().rejected;
+	result.time = scene.GetTime();
+	result.error = scene.GetError();
+	result.wallSeconds = chrono::duration<double>(
+		chrono::steady_clock::now() - start).count();
+
+	return result;
+}
+
+/******************************************************************
+*
+* RunEnsemble
+*
+* Simulates configurations [begin, end), all of the same method, in
+* lockstep and stores their results
+*
+*******************************************************************/
+
+template<class Real>
+static void RunEnsemble(const vector<Configuration>& configs, size_t begin, size_t end,
+                        Scene::Testcase testcase, Scene::Stepping stepping, double duration,
+                        int sample, const char* seriesDir, vector<Result>& results)
+{
+	const auto start = chrono::steady_clock::now();
+
+	vector<EnsembleMember> members;
+
+	for (auto i = begin; i < end; i++)
+		members.push_back(EnsembleMember{ configs[i].mass, configs[i].stiffness,
+		                                  configs[i].damping, configs[i].step });
+
+	BasicEnsemble<Real> ensemble(configs[begin].method, testcase, stepping, members, seriesDir != nullptr);
+
+	ensemble.SetErrorInterval(sample);
+	ensemble.Run(duration);
+
+	const auto wall = chrono::duration<double>(
+		chrono::steady_clock::now() - start).count() / (end - begin);
+
+	for (auto i = begin; i < end; i++)
+	{
+		const auto k = (int)(i - begin);
+		auto& result = results[i];
+
+		result.steps = ensemble.GetSteps(k);
+		result.rejected = 0;
+		result.time = ensemble.GetTime(k);
+		result.error = ensemble.GetError(k);
+		result.wallSeconds = wall;
+		result.diverged = ensemble.IsDiverged(k);
+
+		if (seriesDir && !SaveTrajectory(SeriesName(seriesDir, configs[i]).c_str(),
+		                                ensemble.GetNumPoints(), ensemble.GetSeries(k)))
+			cerr << "Cannot write series of " << SeriesName(seriesDir, configs[i]) << endl;
+	}
+}
+
+/******************************************************************
+*
+* PrintPrecisionReport
+*
+* Summary of -precision compare per method: the worst ratio of the
+* mean float error to the mean double error over all configurations
+* that stayed finite in double, how many of them diverged in float
+* only, and the wall time of float relative to double. A method
+* tolerates float if the ratio stays below tolerated_ratio and no
+* configuration diverges in float only.
+*
+*******************************************************************/
+
+static void PrintPrecisionReport(const vector<Configuration>& configs,
+                                 const vector<Result>& results, const vector<Result>& singles)
+{
+	static constexpr double tolerated_ratio = 1.1;
+
+	for (size_t begin = 0; begin < configs.size(); )
+	{
+		const auto method = configs[begin].method;
+
+		auto worst = 0.0;
+		auto compared = 0, lost = 0;
+		auto wall = 0.0, wallSingle = 0.0;
+
+		auto end = begin;
+
+		for (; end < configs.size() && configs[end].method == method; end++)
+		{
+			const auto& r = results[end];
+			const auto& f = singles[end];
+
+			wall += r.wallSeconds;
+			wallSingle += f.wallSeconds;
+
+			if (r.diverged)
+				continue;
+
+			compared++;
+
+			if (f.diverged)
+				lost++;
+			else
+				worst = max(worst, f.error.Mean() / r.error.Mean());
+		}
+
+		cerr << Scene::GetMethodName(method) << ": float/double error <= " << worst
+		     << ", diverged in float only " << lost << " of " << compared
+		     << ", wall time " << (wall > 0.0 ? wallSingle / wall : 0.0)
+		     << (worst <= tolerated_ratio && lost == 0 ? ", tolerates float" : ", needs double") << endl;
+
+		begin = end;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	/* Defaults match the settings of results/euler.sh */
+	auto testcase = Scene::SPRING;
+	auto stepping = Scene::INPLACE;
+	auto methods = vector<Scene::Method>{ Scene::EULER };
+	auto stiffness = vector<double>{ 70.0 };
+	auto step = vector<double>{ 0.001 };
+	auto damping = vector<double>{ 0.1 };
+	auto mass = vector<double>{ 0.15 };
+	auto duration = 20.0;
+	auto tolerance = 1e-4;
+	auto sample = 1;
+	auto threads = 0;
+	auto batch = 0;
+	auto precision = DOUBLE;
+	const char* out = nullptr;
+	const char* seriesDir = nullptr;
+
+	for (int arg = 1; arg < argc; arg += 2)
+	{
+		if (arg + 1 >= argc)
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		const auto value = argv[arg + 1];
+
+		if (!strcmp(argv[arg], "-testcase"))
+		{
+			if (!Scene::ParseTestcase(value, testcase))
+			{
+				cerr << "Unrecognized testcase: " << value << endl;
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[arg], "-stepping"))
+		{
+			if (!Scene::ParseStepping(value, stepping))
+			{
+				cerr << "Unrecognized stepping: " << value << endl;
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[arg], "-method"))
+			methods = ParseMethods(value);
+		else if (!strcmp(argv[arg], "-stiff"))
+			stiffness = ParseRange(value);
+		else if (!strcmp(argv[arg], "-step"))
+			step = ParseRange(value);
+		else if (!strcmp(argv[arg], "-damp"))
+			damping = ParseRange(value);
+		else if (!strcmp(argv[arg], "-mass"))
+			mass = ParseRange(value);
+		else if (!strcmp(argv[arg], "-duration"))
+			duration = atof(value);
+		else if (!strcmp(argv[arg], "-tol"))
+			tolerance = atof(value);
+		else if (!strcmp(argv[arg], "-sample"))
+		{
+			sample = atoi(value);
+
+			if (sample < 1)
+			{
+				cerr << "Sample interval must be at least 1" << endl;
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[arg], "-threads"))
+			threads = atoi(value);
+		else if (!strcmp(argv[arg], "-ensemble"))
+			batch = atoi(value);
+		else if (!strcmp(argv[arg], "-precision"))
+		{
+			if (!ParsePrecision(value, precision))
+			{
+				cerr << "Unrecognized precision: " << value << endl;
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[arg], "-out"))
+			out = value;
+		else if (!strcmp(argv[arg], "-series"))
+			seriesDir = value;
+		else
+		{
+			cerr << endl << "Unrecognized option: " << argv[arg] << endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	/* The float errors are measured against the analytical solution */
+	if (precision != DOUBLE && testcase >= Scene::CLOTH)
+	{
+		cerr << "Float precision needs an analytical testcase" << endl;
+		return 1;
+	}
+
+	/* Full cartesian product of all parameter ranges */
+	vector<Configuration> configs;
+
+	for (auto m : methods)
+		for (auto h : step)
+			for (auto k : stiffness)
+				for (auto d : damping)
+					for (auto ms : mass)
+						configs.push_back(Configuration{ m, k, h, d, ms });
+
+	vector<Result> results(configs.size());
+	vector<Result> singles(precision == COMPARE ? configs.size() : 0);
+
+	/* Work items [begin, end); batches hold consecutive configurations
+	   of one method, so similar step sizes end up together */
+	vector<pair<size_t, size_t>> items;
+
+	const auto ensemble = batch > 0 && testcase < Scene::CLOTH;
+
+	for (size_t i = 0; i < configs.size(); )
+	{
+		auto end = i + 1;
+
+		if (ensemble && Ensemble::IsSupported(configs[i].method))
+		{
+			while (end < configs.size() && end - i < (size_t)batch &&
+			       configs[end].method == configs[i].method)
+				end++;
+		}
+
+		items.push_back(make_pair(i, end));
+		i = end;
+	}
+
+	if (threads <= 0)
+		threads = max(1, (int)thread::hardware_concurrency());
+
+	const auto start = chrono::steady_clock::now();
+
+	/* Float runs of [begin, end): ensembles where they exist, scenes
+	   stepped in float otherwise */
+	const auto runFloat = [&](const size_t begin, const size_t end,
+	                          const char* series, vector<Result>& into)
+	{
+		if (Ensemble::IsSupported(configs[begin].method))
+			RunEnsemble<float>(configs, begin, end, testcase, stepping, duration, sample, series, into);
+		else
+			into[begin] = Run(configs[begin], testcase, stepping, Scene::FLOAT,
+			                  duration, tolerance, sample, series);
+	};
+
+	/* Workers pull the next work item until all are done */
+	atomic<size_t> next(0);
+	vector<thread> pool;
+
+	for (int t = 0; t < threads; t++)
+	{
+		pool.emplace_back([&]()
+		{
+			for (auto i = next++; i < items.size(); i = next++)
+			{
+				const auto begin = items[i].first;
+				const auto end = items[i].second;
+
+				if (precision == FLOAT)
+					runFloat(begin, end, seriesDir, results);
+				else if (end - begin > 1)
+					RunEnsemble<double>(configs, begin, end, testcase, stepping, duration, sample, seriesDir, results);
+				else
+					results[begin] = Run(configs[begin], testcase, stepping, Scene::DOUBLE,
+					                     duration, tolerance, sample, seriesDir);
+
+				/* Series are those of the double run */
+				if (precision == COMPARE)
+					runFloat(begin, end, nullptr, singles);
+			}
+		});
+	}
+
+	for (auto& worker : pool)
+		worker.join();
+
+	const auto elapsed = chrono::duration<double>(
+		chrono::steady_clock::now() - start).count();
+
+	ofstream file;
+
+	if (out)
+		file.open(out);
+
+	ostream& os = out ? file : cout;
+
+	os << "method;testcase;stiff;step;damp;mass;steps;rejected;t;rms_last;rms_max;rms_mean;wall_s;diverged";
+
+	if (precision == COMPARE)
+		os << ";rms_last_f32;rms_max_f32;rms_mean_f32;wall_s_f32;diverged_f32;ratio_f32";
+
+	os << "\n";
+
+	for (size_t i = 0; i < configs.size(); i++)
+	{
+		const auto& c = configs[i];
+		const auto& r = results[i];
+
+		os << Scene::GetMethodName(c.method) << ";"
+		   << Scene::GetTestcaseName(testcase) << ";"
+		   << c.stiffness << ";" << c.step << ";"
+		   << c.damping << ";" << c.mass << ";"
+		   << r.steps << ";" << r.rejected << ";" << r.time << ";"
+		   << r.error.last << ";" << r.error.max << ";" << r.error.Mean() << ";"
+		   << r.wallSeconds << ";" << (r.diverged ? 1 : 0);
+
+		if (precision == COMPARE)
+		{
+			const auto& f = singles[i];
+
+			os << ";" << f.error.last << ";" << f.error.max << ";" << f.error.Mean() << ";"
+			   << f.wallSeconds << ";" << (f.diverged ? 1 : 0) << ";"
+			   << f.error.Mean() / r.error.Mean();
+		}
+
+		os << "\n";
+	}
+
+	if (precision == COMPARE)
+		PrintPrecisionReport(configs, results, singles);
+
+	cerr << configs.size() << " configurations in " << items.size() << " work items on "
+	     << threads << " threads in " << elapsed << " s";
+
+	if (precision != DOUBLE)
+		cerr << " (" << (precision == FLOAT ? "float" : "double and float") << ")";
+
+	cerr << endl;
+
+	return 0;
+}
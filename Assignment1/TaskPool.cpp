@@ -0,0 +1,341 @@
+/******************************************************************
+*
+* TaskPool.cpp
+*
+* Description: Worker threads, deques and stealing of the task pool,
+* see TaskPool.h
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+/* Standard includes */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+/* Local includes */
+#include "TaskPool.h"
+
+/* Rounds an idle worker yields before it sleeps */
+static constexpr int spin_rounds = 256;
+
+struct TaskRange
+{
+	int begin, end;
+};
+
+/* Ranges of one thread; the owner works at the back, thieves take
+   from the front. Ranges are at least one grain, so a lock per range
+   costs next to nothing. */
+class TaskDeque
+{
+private:
+	mutex lock;
+	vector<TaskRange> ranges;
+	size_t front = 0;
+
+public:
+	void Push(const TaskRange& range)
+	{
+		lock_guard<mutex> guard(lock);
+		ranges.push_back(range);
+	}
+
+	bool Pop(TaskRange& range)
+	{
+		lock_guard<mutex> guard(lock);
+
+		if (front == ranges.size())
+			return false;
+
+		range = ranges.back();
+		ranges.pop_back();
+
+		if (front == ranges.size())
+		{
+			ranges.clear();
+			front = 0;
+		}
+
+		return true;
+	}
+
+	bool Steal(TaskRange& range)
+	{
+		lock_guard<mutex> guard(lock);
+
+		if (front == ranges.size())
+			return false;
+
+		range = ranges[front++];
+
+		if (front == ranges.size())
+		{
+			ranges.clear();
+			front = 0;
+		}
+
+		return true;
+	}
+};
+
+class TaskPool
+{
+private:
+	const int threads;
+
+	/* Deque per thread, 0 belongs to the thread calling Run */
+	vector<unique_ptr<TaskDeque>> deques;
+	vector<thread> workers;
+
+	/* Current loop; set before its ranges are pushed, so every
+	   thread that takes a range sees them */
+	RangeFunction body = nullptr;
+	const void* context = nullptr;
+	int grain = 1;
+	atomic<long> left{0};      /* Indices not yet done */
+
+	atomic<bool> busy{false};
+
+	mutex sleep;
+	condition_variable wake;
+	atomic<unsigned> generation{0};
+	bool stop = false;
+
+	bool Find(int self, TaskRange& range);
+	void Process(int self, TaskRange range);
+	void Work(int self);
+
+public:
+	TaskPool(int threads, bool pin);
+	~TaskPool();
+
+	int Size() const { return threads; }
+
+	void Run(int begin, int end, int grain, RangeFunction body, const void* context);
+};
+
+TaskPool::TaskPool(const int _threads, const bool pin) : threads(max(1, _threads))
+{
+	for (int t = 0; t < threads; t++)
+		deques.emplace_back(new TaskDeque());
+
+	for (int t = 1; t < threads; t++)
+		workers.emplace_back(&TaskPool::Work, this, t);
+
+#ifdef __linux__
+	if (pin)
+	{
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		sched_getaffinity(0, sizeof(allowed), &allowed);
+
+		vector<int> cores;
+
+		for (int c = 0; c < CPU_SETSIZE; c++)
+		{
+			if (CPU_ISSET(c, &allowed))
+				cores.push_back(c);
+		}
+
+		for (int t = 1; t < threads && !cores.empty(); t++)
+		{
+			cpu_set_t core;
+			CPU_ZERO(&core);
+			CPU_SET(cores[t % cores.size()], &core);
+			pthread_setaffinity_np(workers[t - 1].native_handle(), sizeof(core), &core);
+		}
+	}
+#else
+	(void)pin;
+#endif
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		lock_guard<mutex> guard(sleep);
+		stop = true;
+	}
+
+	wake.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+/* Own deque first, then the others starting at the next thread */
+bool TaskPool::Find(const int self, TaskRange& range)
+{
+	if (deques[self]->Pop(range))
+		return true;
+
+	for (int k = 1; k < threads; k++)
+	{
+		if (deques[(self + k) % threads]->Steal(range))
+			return true;
+	}
+
+	return false;
+}
+
+void TaskPool::Process(const int self, TaskRange range)
+{
+	/* Upper halves go to the deque, where thieves find them */
+	while (range.end - range.begin > grain)
+	{
+		const auto grains = (range.end - range.begin + grain - 1) / grain;
+		const auto half = range.begin + grains / 2 * grain;
+
+		deques[self]->Push({ half, range.end });
+		range.end = half;
+	}
+
+	body(context, range.begin, range.end);
+
+	/* Last access to the loop; Run may return right after */
+	left.fetch_sub(range.end - range.begin, memory_order_acq_rel);
+}
+
+void TaskPool::Work(const int self)
+{
+	unsigned seen = 0;
+
+	for (;;)
+	{
+		for (int r = 0; r < spin_rounds && generation.load(memory_order_acquire) == seen; r++)
+			this_thread::yield();
+
+		{
+			unique_lock<mutex> guard(sleep);
+			wake.wait(guard, [&]() { return stop || generation.load() != seen; });
+
+			if (stop)
+				return;
+
+			seen = generation.load();
+		}
+
+		/* Ranges of a later loop may already be taken here, they
+		   always belong to the loop that is running */
+		TaskRange range;
+
+		while (left.load(memory_order_acquire) > 0)
+		{
+			if (Find(self, range))
+				Process(self, range);
+			else
+				this_thread::yield();
+		}
+	}
+}
+
+void TaskPool::Run(const int begin, const int end, const int _grain,
+                   const RangeFunction _body, const void* _context)
+{
+	const auto size = max(1, _grain);
+	auto idle = false;
+
+	/* Inline in the same ranges as on the pool */
+	if (threads == 1 || end - begin <= size || !busy.compare_exchange_strong(idle, true))
+	{
+		for (long first = begin; first < end; first += size)
+			_body(_context, (int)first, (int)min((long)end, first + size));
+
+		return;
+	}
+
+	body = _body;
+	context = _context;
+	grain = size;
+	left.store(end - begin, memory_order_relaxed);
+
+	/* One contiguous part per thread, cut at grain boundaries */
+	const auto grains = ((long)end - begin + grain - 1) / grain;
+
+	for (int t = 0; t < threads; t++)
+	{
+		const auto first = begin + grains * t / threads * grain;
+		const auto last = min((long)end, begin + grains * (t + 1) / threads * grain);
+
+		if (first < last)
+			deques[t]->Push({ (int)first, (int)last });
+	}
+
+	{
+		lock_guard<mutex> guard(sleep);
+		generation.fetch_add(1);
+	}
+
+	wake.notify_all();
+
+	TaskRange range;
+
+	while (left.load(memory_order_acquire) > 0)
+	{
+		if (Find(0, range))
+			Process(0, range);
+		else
+			this_thread::yield();
+	}
+
+	busy.store(false, memory_order_release);
+}
+
+/* Created on first use or when the number of threads changes */
+static mutex pool_lock;
+static unique_ptr<TaskPool> pool;
+
+static int GetDefaultThreads()
+{
+	return max(1, (int)thread::hardware_concurrency());
+}
+
+void SetWorkerThreads(const int threads, const bool pin)
+{
+	const auto count = threads > 0 ? threads : GetDefaultThreads();
+
+	lock_guard<mutex> guard(pool_lock);
+	pool.reset();
+	pool.reset(new TaskPool(count, pin));
+}
+
+static TaskPool& GetPool()
+{
+	lock_guard<mutex> guard(pool_lock);
+
+	if (!pool)
+		pool.reset(new TaskPool(GetDefaultThreads(), false));
+
+	return *pool;
+}
+
+int GetWorkerThreads()
+{
+	return GetPool().Size();
+}
+
+void RunParallel(const int begin, const int end, const int grain,
+                 const RangeFunction body, const void* context)
+{
+	if (begin >= end)
+		return;
+
+	GetPool().Run(begin, end, grain, body, context);
+}
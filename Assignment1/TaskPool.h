@@ -0,0 +1,94 @@
+/******************************************************************
+*
+* TaskPool.h
+*
+* Description: Work-stealing thread pool for the data-parallel
+* loops of a time step (force accumulation and point updates in
+* Exercise.cpp, the implicit, XPBD and contact solvers)
+*
+* The pool keeps its worker threads for the whole run. ParallelFor
+* cuts the index range into one contiguous part per thread, on
+* multiples of the grain, and puts each part on the deque of its
+* thread; the calling thread works on part 0. A thread splits the
+* range it takes in halves down to one grain, keeps the lower half
+* and pushes the upper one on its own deque. It pops from the back
+* of its deque, the most recent and smallest ranges, and once that
+* is empty steals from the front of the other deques, the oldest and
+* largest ones. Threads that run out of work early, e.g. on points
+* of higher degree or on a busy core, so take over the rest of the
+* slower ones.
+*
+* Every index is passed to the body exactly once and ranges never
+* straddle a grain boundary (counted from begin), so loops whose
+* iterations write disjoint data give the same result with any
+* number of threads. Idle workers spin briefly for the next loop,
+* since a step runs several back to back, and then sleep.
+*
+* Only one loop runs at a time; a ParallelFor issued from a second
+* thread while the pool is busy, or from inside a body, runs inline
+* on the calling thread.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __TASK_POOL_H__
+#define __TASK_POOL_H__
+
+/* Body of a loop, called with context and a range [begin, end) */
+typedef void (*RangeFunction)(const void* context, int begin, int end);
+
+/* Threads of the pool including the calling thread, 0 = one per
+   core. With pin, worker t is bound to the t-th core the process may
+   run on (Linux only). Not while a loop runs. */
+void SetWorkerThreads(int threads, bool pin = false);
+int GetWorkerThreads();
+
+/* Calls body for all of [begin, end) in ranges of at most grain
+   indices and returns when all are done */
+void RunParallel(int begin, int end, int grain, RangeFunction body, const void* context);
+
+template<class F>
+void ParallelFor(const int begin, const int end, const int grain, const F& f)
+{
+	RunParallel(begin, end, grain, [](const void* context, const int first, const int last)
+	{
+		(*static_cast<const F*>(context))(first, last);
+	}, &f);
+}
+
+/* Loops over fewer points (buckets, slots) run inline, where the pool
+   costs more than it saves; so do colors with fewer springs */
+static constexpr int parallel_points = 4096;
+static constexpr int parallel_springs = 4096;
+
+/* Indices per range of the loops below */
+static constexpr int parallel_grain = 1024;
+
+/* f(begin, end) for ranges covering [0, n), on the pool above
+   parallel_points and as a single range otherwise */
+template<class F>
+void ParallelRanges(const int n, const F& f)
+{
+	if (n > parallel_points)
+		ParallelFor(0, n, parallel_grain, f);
+	else
+		f(0, n);
+}
+
+/* f(i) for all i in [0, n), see ParallelRanges */
+template<class F>
+void ParallelForEach(const int n, const F& f)
+{
+	ParallelRanges(n, [&](const int begin, const int end)
+	{
+		for (int i = begin; i < end; i++)
+			f(i);
+	});
+}
+
+#endif
@@ -0,0 +1,165 @@
+/******************************************************************
+*
+* TrajectoryDump.cpp
+*
+* Description: Prints a binary trajectory (see TrajectoryRecorder.h)
+* as ";"-separated text with "." as decimal sign - one "t;rms" line
+* per step, optionally followed by "x;y;vx;vy" of one point; runs
+* are separated by an empty line, which gnuplot draws as separate
+* curves
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+/* Standard includes */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+/* Local includes */
+#include "MappedFile.h"
+#include "TrajectoryRecorder.h"
+
+static void PrintUsage()
+{
+	cerr << "Usage: ./TrajectoryDump [file] -[option1] [setting1] ..." << endl;
+	cerr << "Options:" << endl;
+	cerr << "\t-run [only records of this run, default all]" << endl;
+	cerr << "\t-point [append state of this point, needs -record states]" << endl;
+	cerr << "\t-info [1 = print header and counts instead of records]" << endl << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2 || argc % 2 != 0)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	auto run = -1L;
+	auto point = -1L;
+	auto info = false;
+
+	for (int arg = 2; arg < argc; arg += 2)
+	{
+		const auto value = argv[arg + 1];
+
+		if (!strcmp(argv[arg], "-run"))
+			run = atol(value);
+		else if (!strcmp(argv[arg], "-point"))
+			point = atol(value);
+		else if (!strcmp(argv[arg], "-info"))
+			info = atoi(value) != 0;
+		else
+		{
+			cerr << endl << "Unrecognized option: " << argv[arg] << endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	MappedFile file;
+
+	if (!file.Open(argv[1]))
+	{
+		cerr << "Cannot open trajectory: " << argv[1] << endl;
+		return 1;
+	}
+
+	TrajectoryFileHeader header;
+
+	if (file.Size() < sizeof(header))
+	{
+		cerr << "Trajectory too short: " << argv[1] << endl;
+		return 1;
+	}
+
+	memcpy(&header, file.Data(), sizeof(header));
+
+	if (memcmp(header.magic, "MSTRAJ", 7) || header.version != TrajectoryVersion ||
+	    header.byteOrder != TrajectoryByteOrder)
+	{
+		cerr << "Not a version " << TrajectoryVersion << " trajectory of this byte order: " << argv[1] << endl;
+		return 1;
+	}
+
+	const auto n = (long)header.numPoints;
+	const auto fullState = (header.flags & TrajectoryFullState) != 0;
+
+	if (point >= 0 && (!fullState || point >= n))
+	{
+		cerr << "Trajectory has no state of point " << point << endl;
+		return 1;
+	}
+
+	const auto recordBytes = GetTrajectoryRecordSize(header.numPoints, header.flags) * sizeof(double);
+
+	auto offset = sizeof(header);
+	auto records = 0L;
+	auto chunks = 0L;
+	auto lastRun = -1L;
+
+	while (offset + sizeof(TrajectoryChunkHeader) <= file.Size())
+	{
+		TrajectoryChunkHeader chunk;
+		memcpy(&chunk, file.Data() + offset, sizeof(chunk));
+		offset += sizeof(chunk);
+
+		/* A writer that was killed may leave a partial last chunk */
+		if (offset + chunk.numRecords * recordBytes > file.Size())
+		{
+			cerr << "Trajectory ends in a partial chunk" << endl;
+			break;
+		}
+
+		for (uint32_t r = 0; r < chunk.numRecords; r++, offset += recordBytes)
+		{
+			if (info || (run >= 0 && chunk.run != run))
+				continue;
+
+			if (lastRun >= 0 && chunk.run != lastRun)
+				printf("\n");
+
+			lastRun = chunk.run;
+
+			double values[4];
+			memcpy(values, file.Data() + offset, 2 * sizeof(double));
+
+			printf("%.17g;%.17g", values[0], values[1]);
+
+			if (point >= 0)
+			{
+				for (int c = 0; c < 4; c++)
+					memcpy(&values[c], file.Data() + offset + (2 + c * n + point) * sizeof(double), sizeof(double));
+
+				printf(";%.17g;%.17g;%.17g;%.17g", values[0], values[1], values[2], values[3]);
+			}
+
+			printf("\n");
+		}
+
+		records += chunk.numRecords;
+		chunks++;
+		lastRun = info ? (long)chunk.run : lastRun;
+	}
+
+	if (info)
+	{
+		printf("points;%ld\n", n);
+		printf("states;%d\n", fullState ? 1 : 0);
+		printf("runs;%ld\n", lastRun + 1);
+		printf("chunks;%ld\n", chunks);
+		printf("records;%ld\n", records);
+	}
+
+	return 0;
+}
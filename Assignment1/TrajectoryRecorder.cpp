@@ -0,0 +1,200 @@
+/******************************************************************
+*
+* TrajectoryRecorder.cpp
+*
+* Description: Single-producer single-consumer ring buffer between
+* the simulation and the writer thread
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "TrajectoryRecorder.h"
+
+/* Size of the ring buffer in bytes; pages are only touched once the
+   buffer actually fills up that far */
+static constexpr size_t ring_bytes = 16 << 20;
+
+bool SaveTrajectory(const char* path, const int points, const vector<double>& series)
+{
+	ofstream file(path, ios::binary | ios::trunc);
+
+	if (!file)
+		return false;
+
+	TrajectoryFileHeader header = {};
+	memcpy(header.magic, "MSTRAJ", 7);
+	header.version = TrajectoryVersion;
+	header.byteOrder = TrajectoryByteOrder;
+	header.numPoints = (uint32_t)points;
+
+	const TrajectoryChunkHeader chunk = { 0, (uint32_t)(series.size() / 2) };
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+	file.write(reinterpret_cast<const char*>(series.data()), chunk.numRecords * 2 * sizeof(double));
+
+	return (bool)file;
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+	Close();
+}
+
+bool TrajectoryRecorder::Open(const char* path, const int points, const bool fullState)
+{
+	Close();
+
+	file.open(path, ios::binary | ios::trunc);
+
+	if (!file)
+		return false;
+
+	numPoints = (uint32_t)points;
+	flags = fullState ? TrajectoryFullState : 0;
+	recordSize = GetTrajectoryRecordSize(numPoints, flags);
+
+	capacity = max<size_t>(2, ring_bytes / (recordSize * sizeof(double)));
+
+	records.reset(new double[capacity * recordSize]);
+	runs.reset(new uint32_t[capacity]);
+	run = 0;
+	head = 0;
+	tail = 0;
+	dropped = 0;
+
+	TrajectoryFileHeader header = {};
+	memcpy(header.magic, "MSTRAJ", 7);
+	header.version = TrajectoryVersion;
+	header.byteOrder = TrajectoryByteOrder;
+	header.numPoints = numPoints;
+	header.flags = flags;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	running = true;
+	writer = thread(&TrajectoryRecorder::Write, this);
+
+	return true;
+}
+
+void TrajectoryRecorder::Close()
+{
+	if (!writer.joinable())
+		return;
+
+	{
+		lock_guard<mutex> lock(wakeMutex);
+		running = false;
+	}
+
+	wake.notify_one();
+	writer.join();
+
+	file.close();
+
+	if (dropped > 0)
+		cerr << "Trajectory recorder dropped " << dropped << " records" << endl;
+}
+
+template<class Real>
+void TrajectoryRecorder::Record(const double time, const double rms,
+                                const BasicParticleSystem<Real>& particles)
+{
+	const auto h = head.load(memory_order_relaxed);
+
+	/* Never wait for the writer; a full buffer loses the record */
+	if (h - tail.load(memory_order_acquire) == capacity)
+	{
+		dropped++;
+		return;
+	}
+
+	/* Full state of another point count does not fit the records */
+	if ((flags & TrajectoryFullState) && particles.Size() != (int)numPoints)
+	{
+		dropped++;
+		return;
+	}
+
+	const auto slot = h % capacity;
+	auto record = &records[slot * recordSize];
+
+	record[0] = time;
+	record[1] = rms;
+
+	if (flags & TrajectoryFullState)
+	{
+		const auto n = numPoints;
+
+		copy(particles.x.begin(), particles.x.end(), record + 2);
+		copy(particles.y.begin(), particles.y.end(), record + 2 + n);
+		copy(particles.vx.begin(), particles.vx.end(), record + 2 + 2 * n);
+		copy(particles.vy.begin(), particles.vy.end(), record + 2 + 3 * n);
+	}
+
+	runs[slot] = run;
+
+	head.store(h + 1, memory_order_release);
+
+	/* Wake the writer early once half of the buffer is in use */
+	if (h + 1 - tail.load(memory_order_relaxed) == capacity / 2)
+		wake.notify_one();
+}
+
+void TrajectoryRecorder::Write()
+{
+	for (;;)
+	{
+		const auto h = head.load(memory_order_acquire);
+		auto t = tail.load(memory_order_relaxed);
+
+		if (t == h)
+		{
+			unique_lock<mutex> lock(wakeMutex);
+
+			if (!running && head.load(memory_order_acquire) == t)
+				break;
+
+			wake.wait_for(lock, chrono::milliseconds(20));
+			continue;
+		}
+
+		/* One chunk per contiguous, single-run range of the ring */
+		while (t < h)
+		{
+			const auto slot = t % capacity;
+			const auto chunkRun = runs[slot];
+
+			auto count = (size_t)1;
+
+			while (t + count < h && slot + count < capacity && runs[slot + count] == chunkRun)
+				count++;
+
+			const TrajectoryChunkHeader chunk = { chunkRun, (uint32_t)count };
+
+			file.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+			file.write(reinterpret_cast<const char*>(&records[slot * recordSize]),
+			           count * recordSize * sizeof(double));
+
+			t += count;
+		}
+
+		file.flush();
+
+		tail.store(t, memory_order_release);
+	}
+}
+
+template void TrajectoryRecorder::Record(double, double, const ParticleSystem&);
+template void TrajectoryRecorder::Record(double, double, const ParticleSystemF32&);
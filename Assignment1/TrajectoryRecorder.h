@@ -0,0 +1,140 @@
+/******************************************************************
+*
+* TrajectoryRecorder.h
+*
+* Description: Binary recording of per-step simulation records (time,
+* RMS error and optionally positions and velocities of all points);
+* records are put into a ring buffer and written to disk by a
+* background thread, so the simulation never waits for the disk
+*
+* File layout (host byte order, see TrajectoryFileHeader): a 64 byte
+* header followed by chunks, each a TrajectoryChunkHeader and then
+* numRecords records of
+*
+*   double time, rms
+*   double x[points], y[points], vx[points], vy[points]   (full state)
+*
+* A run counts the resets of the scene; records of one chunk always
+* belong to the same run. If the writer falls behind and the ring
+* buffer is full, new records are dropped and counted rather than
+* blocking the simulation; so are full state records of a scene with
+* another number of points than the file.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __TRAJECTORY_RECORDER_H__
+#define __TRAJECTORY_RECORDER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "ParticleSystem.h"
+
+struct TrajectoryFileHeader
+{
+	char magic[8];          /* "MSTRAJ" */
+	uint32_t version;
+	uint32_t byteOrder;     /* 0x01020304 as written by the host */
+	uint32_t numPoints;
+	uint32_t flags;         /* TrajectoryFullState */
+	uint64_t reserved[5];
+};
+
+static_assert(sizeof(TrajectoryFileHeader) == 64, "Trajectory file header must be 64 bytes");
+
+struct TrajectoryChunkHeader
+{
+	uint32_t run;
+	uint32_t numRecords;
+};
+
+static constexpr uint32_t TrajectoryFullState = 1;
+static constexpr uint32_t TrajectoryVersion = 1;
+static constexpr uint32_t TrajectoryByteOrder = 0x01020304;
+
+/* Doubles per record of a file with the given points and flags */
+inline size_t GetTrajectoryRecordSize(const uint32_t numPoints, const uint32_t flags)
+{
+	return 2 + ((flags & TrajectoryFullState) ? 4 * (size_t)numPoints : 0);
+}
+
+/* Write a complete error series (time, rms pairs, no state) of a scene
+   with the given points as one chunk of run 0; false, if the file
+   cannot be written */
+bool SaveTrajectory(const char* path, int points, const vector<double>& series);
+
+class TrajectoryRecorder
+{
+private:
+	ofstream file;
+	thread writer;
+
+	uint32_t numPoints = 0;
+	uint32_t flags = 0;
+	size_t recordSize = 0;       /* Doubles per record */
+	size_t capacity = 0;         /* Records in the ring buffer */
+
+	unique_ptr<double[]> records; /* Ring buffer of capacity records */
+	unique_ptr<uint32_t[]> runs; /* Run of every record */
+	uint32_t run = 0;            /* Run of the next record */
+
+	atomic<uint64_t> head{ 0 };  /* Next record to fill, written by Record */
+	atomic<uint64_t> tail{ 0 };  /* Next record to write, written by writer */
+	atomic<bool> running{ false };
+	long dropped = 0;
+
+	mutex wakeMutex;
+	condition_variable wake;
+
+	void Write();                /* Writer thread */
+
+public:
+	TrajectoryRecorder() {}
+	~TrajectoryRecorder();
+
+	TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+	TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+	/* Create file and start the writer thread; false, if the file
+	   cannot be created */
+	bool Open(const char* path, int points, bool fullState);
+
+	/* Write all buffered records and stop the writer thread */
+	void Close();
+
+	bool IsOpen() const
+	{
+		return running;
+	}
+
+	/* Append a record without blocking; the state is only read in
+	   full state mode and always written as double */
+	template<class Real>
+	void Record(double time, double rms, const BasicParticleSystem<Real>& particles);
+
+	/* Following records belong to a new run (scene was reset) */
+	void NewRun()
+	{
+		run++;
+	}
+
+	long GetDropped() const
+	{
+		return dropped;
+	}
+};
+
+#endif
@@ -0,0 +1,66 @@
+/******************************************************************
+*
+* TripleBuffer.h
+*
+* Description: Lock-free hand-over of the latest value from one
+* writer thread to one reader thread
+*
+* The writer fills its back slot and swaps it with the middle slot;
+* the reader swaps its front slot with the middle slot whenever that
+* holds a newer value. Slot indices are exchanged atomically, so
+* neither side ever waits, the writer may publish faster than the
+* reader reads (values in between are dropped), and the reader keeps
+* its front slot until a newer one exists.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __TRIPLE_BUFFER_H__
+#define __TRIPLE_BUFFER_H__
+
+#include <atomic>
+using namespace std;
+
+template<class T>
+class TripleBuffer
+{
+private:
+	static constexpr int index_mask = 3;
+	static constexpr int fresh = 4;   /* Middle slot not read yet */
+
+	T slots[3];
+
+	int back = 0;                     /* Owned by the writer */
+	int front = 2;                    /* Owned by the reader */
+	atomic<int> middle{ 1 };          /* Index of the shared slot, plus fresh */
+
+public:
+	/* Writer: slot to fill; it holds an older value, not a cleared one */
+	T& Back()
+	{
+		return slots[back];
+	}
+
+	/* Writer: hand the back slot to the reader */
+	void Publish()
+	{
+		back = middle.exchange(back | fresh, memory_order_acq_rel) & index_mask;
+	}
+
+	/* Reader: latest published value, or the previous one if nothing
+	   was published since */
+	const T& Front()
+	{
+		if (middle.load(memory_order_relaxed) & fresh)
+			front = middle.exchange(front, memory_order_acq_rel) & index_mask;
+
+		return slots[front];
+	}
+};
+
+#endif
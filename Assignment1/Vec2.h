@@ -5,6 +5,9 @@
 * Description: Code providing helper function for handling 2D
 * vectors; standard operators and operators are provided  
 *
+* The scalar type is a template parameter; Vec2 is the double
+* vector used throughout, Vec2f its single precision counterpart
+*
 * Physically-Based Simulation Proseminar WS 2015
 * 
 * Interactive Graphics and Simulation Group
@@ -18,94 +21,102 @@
 
 #include <math.h>
 
-class Vec2
+template<class T>
+class BasicVec2
 {
 public:
-	double x, y;
+	T x, y;
 
 public:
-	Vec2(void)
+	BasicVec2(void)
 	{
-		x = 0.0;
-		y = 0.0;
+		x = 0;
+		y = 0;
 	}
 
-	Vec2(double x_, double y_)
+	BasicVec2(T x_, T y_)
 	{
 		x = x_;
 		y = y_;
 	}
 
-	~Vec2(void)
+	/* Conversion between precisions */
+	template<class U>
+	explicit BasicVec2(const BasicVec2<U>& v)
 	{
+		x = (T)v.x;
+		y = (T)v.y;
 	}
 
-	void operator+=(const Vec2& v)
+	void operator+=(const BasicVec2& v)
 	{
 		x += v.x;
 		y += v.y;
 	}
 
-	void operator-=(const Vec2& v)
+	void operator-=(const BasicVec2& v)
 	{
 		x -= v.x;
 		y -= v.y;
 	}
 
-	Vec2 operator+(const Vec2& v) const
+	BasicVec2 operator+(const BasicVec2& v) const
 	{
-		return Vec2(x + v.x, y + v.y);
+		return BasicVec2(x + v.x, y + v.y);
 	}
 
-	Vec2 operator-(const Vec2& v) const
+	BasicVec2 operator-(const BasicVec2& v) const
 	{
-		return Vec2(x - v.x, y - v.y);
+		return BasicVec2(x - v.x, y - v.y);
 	}
 
-	Vec2 operator-() const
+	BasicVec2 operator-() const
 	{
-		return Vec2(-x, -y);
+		return BasicVec2(-x, -y);
 	}
 
-	Vec2 operator*(const double k) const
+	BasicVec2 operator*(const T k) const
 	{
-		return Vec2(k * x, k * y);
+		return BasicVec2(k * x, k * y);
 	}
 
-	Vec2 operator/(const double k) const
+	BasicVec2 operator/(const T k) const
 	{
-		return Vec2(x / k, y / k);
+		return BasicVec2(x / k, y / k);
 	}
 
-	friend Vec2 operator*(double k, const Vec2& v)
+	friend BasicVec2 operator*(T k, const BasicVec2& v)
 	{
-		return Vec2(k * v.x, k * v.y);
+		return BasicVec2(k * v.x, k * v.y);
 	}
 
-	double dot(const Vec2& v) const
+	T dot(const BasicVec2& v) const
 	{
 		return x * v.x + y * v.y;
 	}
 
-	double cross(const Vec2& v) const
+	T cross(const BasicVec2& v) const
 	{
 		return x * v.y - y * v.x;
 	}
 
-	double length(void) const
+	T length(void) const
 	{
 		return sqrt(x * x + y * y);
 	}
 
-    double length_sq(void) const
-    {
-        return x * x + y * y;
-    }
+	T length_sq(void) const
+	{
+		return x * x + y * y;
+	}
 
-	Vec2 normalize() const
+	BasicVec2 normalize() const
 	{
-		return Vec2(x, y) / Vec2(x, y).length();
+		return BasicVec2(x, y) / BasicVec2(x, y).length();
 	}
 };
 
+typedef BasicVec2<double> Vec2;
+typedef BasicVec2<float> Vec2f;
+
 #endif
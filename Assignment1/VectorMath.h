@@ -0,0 +1,127 @@
+/******************************************************************
+*
+* VectorMath.h
+*
+* Description: Branch-free exp, sin and cos for loops the compiler
+* vectorizes; calls to the C library would keep such loops scalar.
+*
+* Arguments are reduced with Cody-Waite constants and the remainders
+* go through Taylor polynomials of high enough degree for an error
+* of a few ulp. Integer parts are extracted by adding 1.5 * 2^52,
+* the quadrant of sin and cos is selected with comparisons, so every
+* lane executes the same instructions and a vectorized loop returns
+* the same bits as a scalar one.
+*
+* exp covers [-708, 709] and clamps outside; sincos is accurate for
+* |x| < 2^20 * pi / 2, about 1.6e6.
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __VECTOR_MATH_H__
+#define __VECTOR_MATH_H__
+
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+/* Adding this rounds |x| < 2^51 to an integer in the low mantissa bits */
+static constexpr double round_shift = 6755399441055744.0;
+
+inline int64_t simd_bits(const double x)
+{
+	int64_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	return bits;
+}
+
+inline double simd_double(const int64_t bits)
+{
+	double x;
+	memcpy(&x, &bits, sizeof(x));
+	return x;
+}
+
+inline double simd_exp(double x)
+{
+	static constexpr double log2e = 1.4426950408889634074;
+	static constexpr double ln2_hi = 6.93147180369123816490e-01;
+	static constexpr double ln2_lo = 1.90821492927058770002e-10;
+
+	x = x < -708.0 ? -708.0 : x;
+	x = x > 709.0 ? 709.0 : x;
+
+	/* x = n ln2 + r, |r| <= ln2 / 2 */
+	const auto shifted = x * log2e + round_shift;
+	const auto n = shifted - round_shift;
+	const auto r = (x - n * ln2_hi) - n * ln2_lo;
+
+	auto p = 1.0 / 6227020800.0;
+	p = p * r + 1.0 / 479001600.0;
+	p = p * r + 1.0 / 39916800.0;
+	p = p * r + 1.0 / 3628800.0;
+	p = p * r + 1.0 / 362880.0;
+	p = p * r + 1.0 / 40320.0;
+	p = p * r + 1.0 / 5040.0;
+	p = p * r + 1.0 / 720.0;
+	p = p * r + 1.0 / 120.0;
+	p = p * r + 1.0 / 24.0;
+	p = p * r + 1.0 / 6.0;
+	p = p * r + 1.0 / 2.0;
+	p = p * r + 1.0;
+	p = p * r + 1.0;
+
+	/* 2^n from the exponent field; n is in [-1022, 1023] */
+	const auto scale = simd_double((simd_bits(shifted) - simd_bits(round_shift) + 1023) << 52);
+
+	return p * scale;
+}
+
+inline void simd_sincos(const double x, double& s, double& c)
+{
+	static constexpr double two_over_pi = 6.36619772367581382433e-01;
+	static constexpr double pio2_1 = 1.57079632673412561417e+00;
+	static constexpr double pio2_2 = 6.07710050630396597660e-11;
+	static constexpr double pio2_3 = 2.02226624871116645580e-21;
+
+	/* x = n pi / 2 + r, |r| <= pi / 4; the first two parts of pi / 2
+	   have 33 bits, so their products with n are exact */
+	const auto n = (x * two_over_pi + round_shift) - round_shift;
+	const auto r = ((x - n * pio2_1) - n * pio2_2) - n * pio2_3;
+	const auto r2 = r * r;
+
+	auto ps = -1.0 / 1307674368000.0;
+	ps = ps * r2 + 1.0 / 6227020800.0;
+	ps = ps * r2 - 1.0 / 39916800.0;
+	ps = ps * r2 + 1.0 / 362880.0;
+	ps = ps * r2 - 1.0 / 5040.0;
+	ps = ps * r2 + 1.0 / 120.0;
+	ps = ps * r2 - 1.0 / 6.0;
+	const auto sr = r + r * r2 * ps;
+
+	auto pc = 1.0 / 20922789888000.0;
+	pc = pc * r2 - 1.0 / 87178291200.0;
+	pc = pc * r2 + 1.0 / 479001600.0;
+	pc = pc * r2 - 1.0 / 3628800.0;
+	pc = pc * r2 + 1.0 / 40320.0;
+	pc = pc * r2 - 1.0 / 720.0;
+	pc = pc * r2 + 1.0 / 24.0;
+	const auto cr = 1.0 - 0.5 * r2 + r2 * r2 * pc;
+
+	/* Quadrant q = n mod 4 in [-2, 2] */
+	const auto q = n - 4.0 * ((n * 0.25 + round_shift) - round_shift);
+
+	const auto odd = q == 1.0 || q == -1.0;
+	const auto a = odd ? cr : sr;
+	const auto b = odd ? sr : cr;
+
+	s = (q == 0.0 || q == 1.0) ? a : -a;
+	c = (q == 0.0 || q == -1.0) ? b : -b;
+}
+
+#endif
@@ -0,0 +1,139 @@
+/******************************************************************
+*
+* XpbdSolver.cpp
+*
+* Description: Substeps and constraint projection of the XPBD
+* step, see XpbdSolver.h
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#include <algorithm>
+#include <cmath>
+
+#include "XpbdSolver.h"
+#include "TaskPool.h"
+#include "PhaseTimers.h"
+
+/* Springs [first, last) in color order; h2 is the squared substep,
+   alpha = 1 / (k h2) the compliance scaled to it */
+template<class Real>
+void XpbdSolver::Project(const double h2, BasicParticleSystem<Real>& particles,
+                         const BasicSpringColoring<Real>& coloring,
+                         const int first, const int last)
+{
+	auto& x = particles.x;
+	auto& y = particles.y;
+
+	for (int s = first; s < last; s++)
+	{
+		const auto a = coloring.i0[s];
+		const auto b = coloring.i1[s];
+		const auto w = weight[a] + weight[b];
+
+		const auto dx = (double)x[a] - x[b];
+		const auto dy = (double)y[a] - y[b];
+		const auto distance = sqrt(dx * dx + dy * dy);
+
+		if (w == 0.0 || coloring.stiffness[s] <= 0.0 || distance < 0.00000001)
+			continue;
+
+		const auto alpha = 1.0 / ((double)coloring.stiffness[s] * h2);
+		const auto c = distance - coloring.restLength[s];
+		const auto delta = (-c - alpha * lambda[s]) / (w + alpha);
+
+		lambda[s] += delta;
+
+		const auto nx = delta * dx / distance;
+		const auto ny = delta * dy / distance;
+
+		x[a] += (Real)(weight[a] * nx);
+		y[a] += (Real)(weight[a] * ny);
+		x[b] -= (Real)(weight[b] * nx);
+		y[b] -= (Real)(weight[b] * ny);
+	}
+}
+
+template<class Real>
+void XpbdSolver::Step(const double dt, BasicParticleSystem<Real>& particles,
+                      const BasicSpringColoring<Real>& coloring)
+{
+	const auto n = particles.Size();
+	const auto count = max(1, substeps);
+	const auto h = dt / count;
+
+	px.resize(n);
+	py.resize(n);
+	weight.resize(n);
+	lambda.resize(coloring.i0.size());
+
+	ParallelForEach(n, [&](const int i)
+	{
+		weight[i] = particles.IsFixed(i) ? 0.0 : particles.invMass[i];
+	});
+
+	for (int step = 0; step < count; step++)
+	{
+		/* Prediction from external forces and damping */
+		ParallelForEach(n, [&](const int i)
+		{
+			px[i] = particles.x[i];
+			py[i] = particles.y[i];
+
+			if (particles.IsFixed(i))
+				return;
+
+			const auto w = (double)particles.invMass[i];
+			const auto scale = 1.0 / (1.0 + h * particles.damping[i] * w);
+
+			particles.vx[i] = (Real)((particles.vx[i] + h * particles.ux[i] * w) * scale);
+			particles.vy[i] = (Real)((particles.vy[i] + h * particles.uy[i] * w) * scale);
+
+			particles.x[i] += (Real)(h * particles.vx[i]);
+			particles.y[i] += (Real)(h * particles.vy[i]);
+		});
+
+		{
+			ScopedPhaseTimer timer(PHASE_FORCES);
+
+			fill(lambda.begin(), lambda.end(), 0.0);
+
+			for (int sweep = 0; sweep < max(1, iterations); sweep++)
+			{
+				for (int c = 0; c < coloring.GetNumColors(); c++)
+				{
+					const auto first = coloring.First(c);
+					const auto last = coloring.Last(c);
+
+					if (!coloring.IsSerial(c) && last - first > parallel_springs)
+					{
+						ParallelFor(first, last, parallel_grain, [&](const int begin, const int end)
+						{
+							Project(h * h, particles, coloring, begin, end);
+						});
+					}
+					else
+						Project(h * h, particles, coloring, first, last);
+				}
+			}
+		}
+
+		/* Velocities from the distance moved */
+		ParallelForEach(n, [&](const int i)
+		{
+			if (particles.IsFixed(i))
+				return;
+
+			particles.vx[i] = (Real)((particles.x[i] - px[i]) / h);
+			particles.vy[i] = (Real)((particles.y[i] - py[i]) / h);
+		});
+	}
+}
+
+template void XpbdSolver::Step(double, ParticleSystem&, const SpringColoring&);
+template void XpbdSolver::Step(double, ParticleSystemF32&, const SpringColoringF32&);
@@ -0,0 +1,67 @@
+/******************************************************************
+*
+* XpbdSolver.h
+*
+* Description: Extended position-based dynamics (XPBD) step for the
+* mass-spring system; every spring is a compliant distance
+* constraint C = |x_0 - x_1| - l with compliance 1 / k, so points
+* follow the elastic springs more closely as the step shrinks, and
+* steps of any length stay stable
+*
+* A step of length h is split into substeps of length h / n. Each
+* substep predicts the velocities from the external forces and the
+* damping of the points, the latter implicitly as
+* v = (v + h u / m) / (1 + h d / m), moves the points, projects the
+* constraints in Gauss-Seidel sweeps in color order and takes the
+* new velocities from the distance moved. Springs of one color share
+* no end points and are projected in parallel, which gives the same
+* result as a serial sweep over the color.
+*
+* Multipliers restart at zero every substep; with several substeps,
+* one sweep per substep is usually enough (Macklin et al., "Small
+* Steps in Physics Simulation").
+*
+* Following Macklin, Mueller and Chentanez, "XPBD: Position-Based
+* Simulation of Compliant Constrained Dynamics"
+*
+* Physically-Based Simulation Proseminar WS 2015
+*
+* Interactive Graphics and Simulation Group
+* Institute of Computer Science
+* University of Innsbruck
+*
+*******************************************************************/
+
+#ifndef __XPBD_SOLVER_H__
+#define __XPBD_SOLVER_H__
+
+#include <vector>
+using namespace std;
+
+#include "ParticleSystem.h"
+#include "SpringColoring.h"
+
+class XpbdSolver
+{
+public:
+	int substeps = 10;  /* Substeps per step */
+	int iterations = 1; /* Gauss-Seidel sweeps per substep */
+
+	/* Advance the free points by h; external forces must be set in
+	   particles.ux/uy, springs are read in color order from coloring;
+	   multipliers and corrections are computed in double */
+	template<class Real>
+	void Step(double h, BasicParticleSystem<Real>& particles,
+	          const BasicSpringColoring<Real>& coloring);
+
+private:
+	vector<double> px, py;  /* Positions at the start of a substep */
+	vector<double> weight;  /* Inverse mass, 0 for fixed points */
+	vector<double> lambda;  /* Multiplier per spring in color order */
+
+	template<class Real>
+	void Project(double h2, BasicParticleSystem<Real>& particles,
+	             const BasicSpringColoring<Real>& coloring, int first, int last);
+};
+
+#endif
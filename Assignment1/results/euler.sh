@@ -1,24 +1,10 @@
 #!/bin/sh
-echo "start"
-b=1
-DATEIENDUNG=txt
+# Stiffness x step sweep for euler; all runs simulate 20 s headless
+# and write euler<stiff>_<step>.txt for euler_gnuplot.sh
+./MassSpringSweep -method euler -stiff 70:160:10 -step 0.001:0.004:0.001 \
+	-damp 0.1 -mass 0.15 -duration 20 -ensemble 64 -series . -out euler_sweep.txt
 
-until [ $b -gt 4 ]
-do 
-	a=70
-	eu=`echo "scale=5; $b * 0.001" | bc`
-
-	until [ $a -gt 160 ]
-	do
-	NEWNAME="euler"$a"_0"
-	./Assignment1 -method euler -stiff $a -step $eu -damp 0.1 -mass 0.15  & epid=$!
-	(sleep 20 && kill -9 $epid) 
-	cp lastrun_0.log  $(printf $NEWNAME$eu).$DATEIENDUNG
-	a=`expr $a + 10`
-	
-	done
-	
-	b=`expr $b + 1`
-	
+# Convert the binary error series to the ";"-separated text
+for f in euler*.traj; do
+	./TrajectoryDump "$f" > "${f%.traj}.txt" && rm "$f"
 done
-
@@ -1,24 +1,10 @@
 #!/bin/sh
-echo "start"
-b=5
-DATEIENDUNG=txt
+# Stiffness x step sweep for leapfrog; all runs simulate 20 s headless
+# and write leapfrog<stiff>_<step>.txt for leapfrog_gnuplot.sh
+./MassSpringSweep -method leapfrog -stiff 70:160:10 -step 0.075:0.12:0.015 \
+	-damp 0.1 -mass 0.15 -duration 20 -ensemble 64 -series . -out leapfrog_sweep.txt
 
-until [ $b -gt 8 ]
-do 
-	a=70
-	eu=`echo "scale=5; $b * 0.015" | bc`
-
-	until [ $a -gt 160 ]
-	do
-	NEWNAME="leapfrog"$a"_0"
-	./Assignment1 -method leapfrog -stiff $a -step $eu -damp 0.1 -mass 0.15  & epid=$!
-	(sleep 20 && kill -9 $epid) 
-	cp lastrun_2.log  $(printf $NEWNAME$eu).$DATEIENDUNG
-	a=`expr $a + 10`
-	
-	done
-	
-	b=`expr $b + 1`
-	
+# Convert the binary error series to the ";"-separated text
+for f in leapfrog*.traj; do
+	./TrajectoryDump "$f" > "${f%.traj}.txt" && rm "$f"
 done
-
@@ -1,24 +1,10 @@
 #!/bin/sh
-echo "start"
-b=5
-DATEIENDUNG=txt
+# Stiffness x step sweep for midpoint; all runs simulate 20 s headless
+# and write midpoint<stiff>_<step>.txt for midpoint_gnuplot.sh
+./MassSpringSweep -method midpoint -stiff 70:160:10 -step 0.05:0.08:0.01 \
+	-damp 0.1 -mass 0.15 -duration 20 -ensemble 64 -series . -out midpoint_sweep.txt
 
-until [ $b -gt 8 ]
-do 
-	a=70
-	eu=`echo "scale=5; $b * 0.01" | bc`
-
-	until [ $a -gt 160 ]
-	do
-	NEWNAME="midpoint"$a"_0"
-	./Assignment1 -method midpoint -stiff $a -step $eu -damp 0.1 -mass 0.15  & epid=$!
-	(sleep 20 && kill -9 $epid) 
-	cp lastrun_3.log  $(printf $NEWNAME$eu).$DATEIENDUNG
-	a=`expr $a + 10`
-	
-	done
-	
-	b=`expr $b + 1`
-	
+# Convert the binary error series to the ";"-separated text
+for f in midpoint*.traj; do
+	./TrajectoryDump "$f" > "${f%.traj}.txt" && rm "$f"
 done
-
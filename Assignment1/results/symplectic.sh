@@ -1,24 +1,10 @@
 #!/bin/sh
-echo "start"
-b=7
-DATEIENDUNG=txt
+# Stiffness x step sweep for symplectic; all runs simulate 20 s headless
+# and write symplectic<stiff>_<step>.txt for symplectic_gnuplot.sh
+./MassSpringSweep -method symplectic -stiff 70:160:30 -step 0.0525:0.075:0.0075 \
+	-damp 0.1 -mass 0.15 -duration 20 -ensemble 64 -series . -out symplectic_sweep.txt
 
-until [ $b -gt 10 ]
-do 
-	a=70
-	eu=`echo "scale=5; $b * 0.0075" | bc`
-
-	until [ $a -gt 160 ]
-	do
-	NEWNAME="symplectic"$a"_0"
-	./Assignment1 -method symplectic -stiff $a -step $eu -damp 0.1 -mass 0.15  & epid=$!
-	(sleep 20 && kill -9 $epid) 
-	cp lastrun_1.log  $(printf $NEWNAME$eu).$DATEIENDUNG
-	a=`expr $a + 30`
-	
-	done
-	
-	b=`expr $b + 1`
-	
+# Convert the binary error series to the ";"-separated text
+for f in symplectic*.traj; do
+	./TrajectoryDump "$f" > "${f%.traj}.txt" && rm "$f"
 done
-